@@ -15,6 +15,9 @@
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/stringize.hpp>
 
+//! Number of claims in the synthetic trie of the claimtrie database benchmarks
+static const int64_t DEFAULT_CLAIMTRIE_BENCH_CLAIMS = 100000;
+
 // Simple micro-benchmarking framework; API mostly matches a subset of the Google Benchmark
 // framework (see https://github.com/google/benchmark)
 // Why not use the Google Benchmark framework? Because adding Yet Another Dependency
@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 
+#include <chainparamsbase.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 
@@ -29,6 +30,9 @@ static void SetupBenchArgs()
     gArgs.AddArg("-plot-plotlyurl=<uri>", strprintf("URL to use for plotly.js (default: %s)", DEFAULT_PLOT_PLOTLYURL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-plot-width=<x>", strprintf("Plot width in pixel (default: %u)", DEFAULT_PLOT_WIDTH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-plot-height=<x>", strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimtrieclaims=<n>", strprintf("Number of claims in the trie of the Claimtrie benchmarks (default: %u)", DEFAULT_CLAIMTRIE_BENCH_CLAIMS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-replaychain=<chain>", strprintf("Chain of the blocks replayed by ConnectBlockReplay (default: %s)", CBaseChainParams::MAIN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-replaydir=<dir>", "Directory with the data directory snapshot and recorded blocks replayed by ConnectBlockReplay, which does nothing without it", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 }
 
 int main(int argc, char** argv)
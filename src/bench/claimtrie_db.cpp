@@ -0,0 +1,302 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <claimtrie/forks.h>
+#include <fs.h>
+#include <hash.h>
+#include <nameclaim.h>
+#include <random.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * Claimtrie database workloads under each combination of memory mapping and page size.
+ *
+ * The trie is synthetic, generated to resemble mainnet's shape rather than copied from it:
+ * -claimtrieclaims claims (default 100000) over a quarter as many names, with name popularity
+ * following a Zipf distribution, so that a few names hold up to 64 competing claims and
+ * most hold one. Names are 3 to 40 characters, amounts are spread over seven orders of
+ * magnitude, there is one support for every three claims, skewed the same way, and all of
+ * it is added over a hundred blocks, once, with each benchmark working on a copy. Lookups
+ * pick names by the same popularity, and each connected block adds new claims and supports
+ * and updates existing claims.
+ *
+ * What it does not measure:
+ *  - mainnet's actual names and distributions, nor expirations and takeovers at its scale;
+ *    ConnectBlockReplay runs recorded mainnet blocks against a real data directory for that
+ *  - reads from a cold OS page cache, as the freshly written database file is still in it
+ *  - anything around the claimtrie in ConnectBlock, such as script checks or coins
+ */
+
+static const int BLOCKS_TO_FILL = 100;
+static const int LOOKUPS = 200;
+static const int BLOCK_CLAIMS = 150;
+static const int BLOCK_SUPPORTS = 50;
+static const int BLOCK_UPDATES = 20;
+static const std::size_t MAX_NAME_CLAIMS = 64;
+
+// Names picked with Zipf distributed popularity
+class ClaimtrieWorkload
+{
+    std::vector<std::string> m_names;
+    std::vector<double> m_cdf;
+
+public:
+    FastRandomContext rng{true};
+
+    explicit ClaimtrieWorkload(std::size_t nameCount)
+    {
+        static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789-";
+        double total = 0;
+        for (std::size_t i = 0; i < nameCount; ++i) {
+            // mostly short names, a tail of long ones
+            std::size_t length = 3 + std::min<uint64_t>(rng.randrange(12) + rng.randrange(12) * rng.randrange(3), 37);
+            std::string name;
+            for (std::size_t j = 0; j < length; ++j)
+                name += chars[rng.randrange(sizeof(chars) - 1)];
+            m_names.push_back(name + std::to_string(i));
+            total += 1.0 / std::pow(double(i + 1), 1.1);
+            m_cdf.push_back(total);
+        }
+        for (auto& c : m_cdf)
+            c /= total;
+    }
+
+    std::size_t NameCount() const { return m_names.size(); }
+    const std::string& Name(std::size_t i) const { return m_names[i]; }
+
+    std::size_t PopularIndex()
+    {
+        const double x = rng.randrange(1 << 30) / double(1 << 30);
+        return std::min<std::size_t>(std::lower_bound(m_cdf.begin(), m_cdf.end(), x) - m_cdf.begin(), m_names.size() - 1);
+    }
+    const std::string& PopularName() { return m_names[PopularIndex()]; }
+
+    // 0.001 to 10000 LBC, uniform in magnitude
+    int64_t Amount() { return int64_t(std::pow(10.0, 5 + rng.randrange(7000) / 1000.0)); }
+
+    COutPoint NewOutPoint()
+    {
+        return COutPoint(rng.rand256(), rng.randrange(4));
+    }
+};
+
+struct ClaimRecord {
+    std::size_t name;
+    uint160 claimId;
+    COutPoint outPoint;
+};
+
+// The claims added so far, and which of them are on each name
+struct ClaimRecords {
+    std::vector<ClaimRecord> claims;
+    std::vector<std::vector<std::size_t>> byName;
+    explicit ClaimRecords(std::size_t nameCount) : byName(nameCount) {}
+};
+
+// A name for a new claim by popularity, passing over names already at MAX_NAME_CLAIMS
+static std::size_t NewClaimName(ClaimtrieWorkload& workload, const ClaimRecords& records)
+{
+    auto name = workload.PopularIndex();
+    while (records.byName[name].size() >= MAX_NAME_CLAIMS)
+        name = workload.rng.randrange(workload.NameCount());
+    return name;
+}
+
+static std::unique_ptr<CClaimTrie> OpenClaimtrie(const fs::path& dir, bool fWipe, int height, std::size_t mmapBytes, int pageSize)
+{
+    // a small page cache so that lookups actually go to the file, as they do when it's larger than RAM
+    return std::make_unique<CClaimTrie>(1 << 20, fWipe, height, dir.string(), 1000000, 1, -1,
+                                        262974, 2102400, 1000000, 1000000, 32, 0, 0, mmapBytes, pageSize);
+}
+
+static void AddClaim(CClaimTrieCache& cache, ClaimtrieWorkload& workload, ClaimRecords& records, std::size_t name, int height)
+{
+    auto outPoint = workload.NewOutPoint();
+    records.byName[name].push_back(records.claims.size());
+    records.claims.push_back({name, ClaimIdHash(outPoint.hash, outPoint.n), outPoint});
+    bool added = cache.addClaim(workload.Name(name), outPoint, records.claims.back().claimId, workload.Amount(), height);
+    assert(added);
+}
+
+// Supports go to claims on popular names, as the claims themselves do
+static void AddSupport(CClaimTrieCache& cache, ClaimtrieWorkload& workload, const ClaimRecords& records, int height)
+{
+    const auto& onName = records.byName[workload.PopularIndex()];
+    const auto& claim = records.claims[onName.empty() ? workload.rng.randrange(records.claims.size()) : onName[workload.rng.randrange(onName.size())]];
+    bool added = cache.addSupport(workload.Name(claim.name), workload.NewOutPoint(), claim.claimId, workload.Amount(), height);
+    assert(added);
+}
+
+static void UpdateClaim(CClaimTrieCache& cache, ClaimtrieWorkload& workload, ClaimRecords& records, int height)
+{
+    auto& claim = records.claims[workload.rng.randrange(records.claims.size())];
+    std::string nodeName;
+    int validHeight, originalHeight;
+    if (!cache.removeClaim(claim.claimId, claim.outPoint, nodeName, validHeight, originalHeight))
+        return;
+    claim.outPoint = workload.NewOutPoint();
+    bool added = cache.addClaim(workload.Name(claim.name), claim.outPoint, claim.claimId, workload.Amount(), height, -1, originalHeight);
+    assert(added);
+}
+
+// The filled claimtrie, built once and shared by every benchmark
+class ClaimtrieTemplate
+{
+public:
+    const fs::path dir;
+    ClaimtrieWorkload workload;
+    ClaimRecords records;
+    int height = 1;
+
+    ClaimtrieTemplate()
+        : dir(fs::temp_directory_path() / fs::unique_path("claimtrie_bench_%%%%-%%%%")),
+          workload(std::max<int64_t>(gArgs.GetArg("-claimtrieclaims", DEFAULT_CLAIMTRIE_BENCH_CLAIMS) / 4, 1)),
+          records(workload.NameCount())
+    {
+        fs::create_directories(dir);
+        const int64_t total = std::max<int64_t>(gArgs.GetArg("-claimtrieclaims", DEFAULT_CLAIMTRIE_BENCH_CLAIMS), 1);
+        auto trie = OpenClaimtrie(dir, true, height, 0, 0);
+        // every name gets one claim, the rest of them go by popularity
+        for (int block = 0; block < BLOCKS_TO_FILL; ++block) {
+            CClaimTrieCache cache(trie.get());
+            const int64_t end = total * (block + 1) / BLOCKS_TO_FILL;
+            for (int64_t i = records.claims.size(); i < end; ++i) {
+                AddClaim(cache, workload, records, i < int64_t(workload.NameCount()) ? i : NewClaimName(workload, records), height);
+                if (i % 3 == 0)
+                    AddSupport(cache, workload, records, height);
+            }
+            bool ok = cache.incrementBlock() && cache.flush();
+            assert(ok);
+            ++height;
+        }
+    }
+
+    ~ClaimtrieTemplate()
+    {
+        fs::remove_all(dir);
+    }
+
+    static ClaimtrieTemplate& Get()
+    {
+        static ClaimtrieTemplate instance;
+        return instance;
+    }
+};
+
+// A copy of the template's database for one benchmark to work on
+class ClaimtrieSetup
+{
+public:
+    const fs::path dir;
+    ClaimtrieWorkload& workload;
+    ClaimRecords records;
+    int height;
+
+    ClaimtrieSetup()
+        : dir(fs::temp_directory_path() / fs::unique_path("claimtrie_bench_%%%%-%%%%")),
+          workload(ClaimtrieTemplate::Get().workload),
+          records(ClaimtrieTemplate::Get().records),
+          height(ClaimtrieTemplate::Get().height)
+    {
+        fs::create_directories(dir);
+        for (const auto& entry : fs::directory_iterator(ClaimtrieTemplate::Get().dir))
+            fs::copy_file(entry.path(), dir / entry.path().filename());
+    }
+
+    ~ClaimtrieSetup()
+    {
+        fs::remove_all(dir);
+    }
+};
+
+// Name lookups against a claimtrie database with the given memory mapping and page size
+static void ClaimtrieLookups(benchmark::State& state, std::size_t mmapBytes, int pageSize)
+{
+    ClaimtrieSetup setup;
+    auto trie = OpenClaimtrie(setup.dir, false, setup.height, mmapBytes, pageSize);
+    CClaimTrieCache cache(trie.get());
+    while (state.KeepRunning()) {
+        for (int i = 0; i < LOOKUPS; ++i)
+            cache.getClaimsForName(setup.workload.PopularName());
+    }
+}
+
+// Connecting blocks of new claims, supports and updates, each flushed to the database
+static void ClaimtrieBlocks(benchmark::State& state, std::size_t mmapBytes, int pageSize)
+{
+    ClaimtrieSetup setup;
+    auto trie = OpenClaimtrie(setup.dir, false, setup.height, mmapBytes, pageSize);
+    while (state.KeepRunning()) {
+        CClaimTrieCache cache(trie.get());
+        // a third of the new claims go to names picked at random rather than by popularity
+        for (int i = 0; i < BLOCK_CLAIMS; ++i) {
+            auto name = i % 3 ? NewClaimName(setup.workload, setup.records) : setup.workload.rng.randrange(setup.workload.NameCount());
+            AddClaim(cache, setup.workload, setup.records, name, setup.height);
+        }
+        for (int i = 0; i < BLOCK_SUPPORTS; ++i)
+            AddSupport(cache, setup.workload, setup.records, setup.height);
+        for (int i = 0; i < BLOCK_UPDATES; ++i)
+            UpdateClaim(cache, setup.workload, setup.records, setup.height);
+        bool ok = cache.incrementBlock();
+        cache.getMerkleHash();
+        ok = ok && cache.flush();
+        assert(ok);
+        ++setup.height;
+    }
+}
+
+static void ClaimtrieLookupsDefault(benchmark::State& state)
+{
+    ClaimtrieLookups(state, 0, 0);
+}
+
+static void ClaimtrieLookupsMmap(benchmark::State& state)
+{
+    ClaimtrieLookups(state, 256 << 20, 0);
+}
+
+static void ClaimtrieLookupsLargePages(benchmark::State& state)
+{
+    ClaimtrieLookups(state, 0, 16384);
+}
+
+static void ClaimtrieLookupsMmapLargePages(benchmark::State& state)
+{
+    ClaimtrieLookups(state, 256 << 20, 16384);
+}
+
+static void ClaimtrieBlocksDefault(benchmark::State& state)
+{
+    ClaimtrieBlocks(state, 0, 0);
+}
+
+static void ClaimtrieBlocksMmap(benchmark::State& state)
+{
+    ClaimtrieBlocks(state, 256 << 20, 0);
+}
+
+static void ClaimtrieBlocksLargePages(benchmark::State& state)
+{
+    ClaimtrieBlocks(state, 0, 16384);
+}
+
+static void ClaimtrieBlocksMmapLargePages(benchmark::State& state)
+{
+    ClaimtrieBlocks(state, 256 << 20, 16384);
+}
+
+BENCHMARK(ClaimtrieLookupsDefault, 20);
+BENCHMARK(ClaimtrieLookupsMmap, 20);
+BENCHMARK(ClaimtrieLookupsLargePages, 20);
+BENCHMARK(ClaimtrieLookupsMmapLargePages, 20);
+BENCHMARK(ClaimtrieBlocksDefault, 4);
+BENCHMARK(ClaimtrieBlocksMmap, 4);
+BENCHMARK(ClaimtrieBlocksLargePages, 4);
+BENCHMARK(ClaimtrieBlocksMmapLargePages, 4);
@@ -59,6 +59,40 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// Coin selection in a wallet that has collected a hundred thousand small payments, such as one
+// receiving tips, the way CreateTransaction goes about it: branch and bound first, then knapsack.
+static void CoinSelectionManySmallCoins(benchmark::State& state)
+{
+    auto chain = interfaces::MakeChain();
+    const CWallet wallet(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    std::vector<std::unique_ptr<CWalletTx>> wtxs;
+    LOCK(wallet.cs_wallet);
+
+    FastRandomContext rand(true);
+    for (int i = 0; i < 100000; ++i) {
+        addCoin(1000 + rand.randrange(COIN / 100), wallet, wtxs);
+    }
+
+    std::vector<OutputGroup> groups;
+    for (const auto& wtx : wtxs) {
+        COutput output(wtx.get(), 0 /* iIn */, 6 * 24 /* nDepthIn */, true /* spendable */, true /* solvable */, true /* safe */);
+        groups.emplace_back(output.GetInputCoin(), 6, false, 0, 0);
+    }
+
+    const CoinEligibilityFilter filter_standard(1, 6, 0);
+    const CoinSelectionParams params_bnb(true, 34, 148, CFeeRate(0), 0);
+    const CoinSelectionParams params_knapsack(false, 34, 148, CFeeRate(0), 0);
+    while (state.KeepRunning()) {
+        std::set<CInputCoin> setCoinsRet;
+        CAmount nValueRet;
+        bool bnb_used;
+        bool success = wallet.SelectCoinsMinConf(COIN, filter_standard, groups, setCoinsRet, nValueRet, params_bnb, bnb_used) ||
+                       wallet.SelectCoinsMinConf(COIN, filter_standard, groups, setCoinsRet, nValueRet, params_knapsack, bnb_used);
+        assert(success);
+        assert(nValueRet >= COIN);
+    }
+}
+
 typedef std::set<CInputCoin> CoinSet;
 static auto testChain = interfaces::MakeChain();
 static const CWallet testWallet(testChain.get(), WalletLocation(), WalletDatabase::CreateDummy());
@@ -108,3 +142,4 @@ static void BnBExhaustion(benchmark::State& state)
 
 BENCHMARK(CoinSelection, 650);
 BENCHMARK(BnBExhaustion, 650);
+BENCHMARK(CoinSelectionManySmallCoins, 5);
@@ -0,0 +1,191 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <core_io.h>
+#include <fs.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <util/validation.h>
+#include <validation.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+extern std::unique_ptr<CClaimTrie> g_claimtrie;
+
+/**
+ * Replays recorded blocks through ConnectBlock, on top of a snapshot of a node's data directory.
+ *
+ * -replaydir points at a directory holding:
+ *   snapshot/    a copy of the data directory of a node stopped cleanly at the starting height
+ *   blocks.hex   the blocks that follow it, one per line, as returned by getblock <hash> 0
+ *
+ * The snapshot is copied to a temporary directory (block files are linked rather than copied,
+ * as nothing reads or writes them), and every iteration connects the whole range into a fresh
+ * coins view and claimtrie cache which are then thrown away, so iterations start from the same
+ * state. Scripts are always verified, as nothing sets -assumevalid here. The totals of the
+ * ConnectBlock phases logged with -debug=bench are printed on stderr at the end.
+ */
+
+static void CopySnapshot(const fs::path& from, const fs::path& to)
+{
+    fs::create_directories(to);
+    for (const auto& entry : fs::directory_iterator(from)) {
+        const auto target = to / entry.path().filename();
+        if (fs::is_directory(entry.status()))
+            CopySnapshot(entry.path(), target);
+        else if (from.filename() == "blocks" && entry.path().extension() == ".dat")
+            fs::create_symlink(fs::absolute(entry.path()), target);
+        else
+            fs::copy_file(entry.path(), target);
+    }
+}
+
+static bool ReadRecordedBlocks(const fs::path& file, std::vector<CBlock>& blocks)
+{
+    std::ifstream stream(file.string());
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty())
+            continue;
+        blocks.emplace_back();
+        if (!DecodeHexBlk(blocks.back(), line))
+            return false;
+    }
+    return !blocks.empty();
+}
+
+// Swaps the chainstate and claimtrie set up for the benchmarks for the ones in a snapshot
+class ReplaySetup
+{
+    const std::string m_datadir;
+    const fs::path m_path;
+
+    static void Unload() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        UnloadBlockIndex();
+        g_chainstate = MakeUnique<CChainState>();
+        g_claimtrie.reset();
+        pblocktree.reset();
+    }
+
+public:
+    explicit ReplaySetup(const fs::path& snapshot)
+        : m_datadir(gArgs.GetArg("-datadir", "")),
+          m_path(fs::temp_directory_path() / fs::unique_path("connectblock_replay_%%%%-%%%%"))
+    {
+        SelectParams(gArgs.GetArg("-replaychain", CBaseChainParams::MAIN));
+        CopySnapshot(snapshot, m_path);
+        LOCK(cs_main);
+        Unload();
+        gArgs.ForceSetArg("-datadir", m_path.string());
+        ClearDatadirCache();
+        fCheckBlockIndex = false;
+    }
+
+    ~ReplaySetup()
+    {
+        {
+            LOCK(cs_main);
+            Unload();
+        }
+        gArgs.ForceSetArg("-datadir", m_datadir);
+        ClearDatadirCache();
+        SelectParams(CBaseChainParams::REGTEST);
+        fCheckBlockIndex = true;
+        fs::remove_all(m_path);
+    }
+
+    bool Load(std::string& error)
+    {
+        const CChainParams& chainparams = Params();
+        LOCK(cs_main);
+        pblocktree.reset(new CBlockTreeDB(1 << 23, false, false));
+        if (!LoadBlockIndex(chainparams)) {
+            error = "Error loading block index database";
+            return false;
+        }
+        ::ChainstateActive().InitCoinsDB(1 << 23, false, false);
+        ::ChainstateActive().InitCoinsCache();
+        if (!::ChainstateActive().LoadChainTip(chainparams)) {
+            error = "Error initializing block database";
+            return false;
+        }
+        auto tip = ::ChainActive().Tip();
+        if (!::ClaimtrieCache().validateDb(tip->nHeight, tip->hashClaimTrie)) {
+            error = "Error validating the stored claim trie";
+            return false;
+        }
+        return true;
+    }
+};
+
+static void ConnectBlockReplay(benchmark::State& state)
+{
+    const std::string replaydir = gArgs.GetArg("-replaydir", "");
+    if (replaydir.empty())
+        return;
+
+    std::vector<CBlock> blocks;
+    if (!ReadRecordedBlocks(fs::path(replaydir) / "blocks.hex", blocks)) {
+        tfm::format(std::cerr, "Error reading recorded blocks from %s\n", replaydir);
+        return;
+    }
+
+    ReplaySetup setup(fs::path(replaydir) / "snapshot");
+    std::string error;
+    if (!setup.Load(error)) {
+        tfm::format(std::cerr, "%s in %s\n", error, replaydir);
+        return;
+    }
+
+    const CChainParams& chainparams = Params();
+    std::vector<CBlockHeader> headers(blocks.begin(), blocks.end());
+    {
+        LOCK(cs_main);
+        if (headers.front().hashPrevBlock != ::ChainActive().Tip()->GetBlockHash()) {
+            tfm::format(std::cerr, "The recorded blocks do not start at the snapshot tip, height %d\n", ::ChainActive().Height());
+            return;
+        }
+    }
+    CValidationState validation_state;
+    if (!ProcessNewBlockHeaders(headers, validation_state, chainparams)) {
+        tfm::format(std::cerr, "Error accepting the recorded headers: %s\n", FormatStateMessage(validation_state));
+        return;
+    }
+
+    LOCK(cs_main);
+    std::vector<CBlockIndex*> indexes;
+    for (const auto& block : blocks)
+        indexes.push_back(LookupBlockIndex(block.GetHash()));
+
+    const auto before = GetConnectBlockTimings();
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&::ChainstateActive().CoinsTip());
+        auto trieCache = ::ClaimtrieCache();
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            bool connected = ::ChainstateActive().ConnectBlock(blocks[i], validation_state, indexes[i], view, trieCache, chainparams, true);
+            assert(connected);
+            view.SetBestBlock(indexes[i]->GetBlockHash());
+        }
+    }
+    const auto after = GetConnectBlockTimings();
+
+    const double blocksTotal = after.nBlocks - before.nBlocks;
+    auto report = [blocksTotal](const char* phase, int64_t micros) {
+        tfm::format(std::cerr, "%-24s %10.2fms (%.3fms/blk)\n", phase, micros * 0.001, micros * 0.001 / blocksTotal);
+    };
+    tfm::format(std::cerr, "Replayed %d blocks from height %d, %d times\n", blocks.size(), indexes.front()->nHeight, int64_t(blocksTotal) / blocks.size());
+    report("Sanity checks", after.nCheck - before.nCheck);
+    report("Fork checks", after.nForks - before.nForks);
+    report("Connect transactions", after.nConnect - before.nConnect);
+    report("Claimtrie update", after.nClaimtrie - before.nClaimtrie);
+    report("Verify (incl. above)", after.nVerify - before.nVerify);
+}
+
+BENCHMARK(ConnectBlockReplay, 1);
@@ -0,0 +1,91 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/policy.h>
+#include <random.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static const size_t CHAIN_TX_COUNT = 1000;
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, 1000, 0, 1, false, 4, lp));
+}
+
+// Transactions that each spend two of the most recent outputs of the ones before, so that
+// they form a dense web with long ancestries and overlapping descendants.
+static std::vector<CTransactionRef> CreateChainedTransactions(size_t count)
+{
+    FastRandomContext rng(true);
+    std::vector<CTransactionRef> txs;
+    std::vector<COutPoint> unspent{COutPoint(uint256(), 0), COutPoint(uint256(), 1)};
+    for (size_t i = 0; i < count; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (auto& txin : tx.vin) {
+            const size_t window = std::min<size_t>(unspent.size(), 20);
+            auto pick = unspent.end() - 1 - rng.randrange(window);
+            txin.prevout = *pick;
+            txin.scriptSig = CScript() << OP_1;
+            unspent.erase(pick);
+        }
+        tx.vout.resize(3);
+        for (auto& txout : tx.vout) {
+            txout.scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            txout.nValue = COIN;
+        }
+        txs.push_back(MakeTransactionRef(tx));
+        for (uint32_t n = 0; n < tx.vout.size(); ++n)
+            unspent.emplace_back(txs.back()->GetHash(), n);
+    }
+    return txs;
+}
+
+// Ancestor and descendant walks from every transaction of the pool
+static void MempoolChainWalks(benchmark::State& state)
+{
+    const auto txs = CreateChainedTransactions(CHAIN_TX_COUNT);
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    for (const auto& tx : txs)
+        AddTx(tx, pool);
+
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    while (state.KeepRunning()) {
+        for (const auto& tx : txs) {
+            auto it = pool.mapTx.find(tx->GetHash());
+            CTxMemPool::setEntries ancestors, descendants;
+            pool.CalculateMemPoolAncestors(*it, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+            pool.CalculateDescendants(it, descendants);
+        }
+    }
+}
+
+// Re-adding the first half of the transactions as if a block holding them was disconnected,
+// after the second half already is in the pool
+static void MempoolChainReorg(benchmark::State& state)
+{
+    const auto txs = CreateChainedTransactions(CHAIN_TX_COUNT);
+    std::vector<uint256> disconnected;
+    for (size_t i = 0; i < txs.size() / 2; ++i)
+        disconnected.push_back(txs[i]->GetHash());
+
+    while (state.KeepRunning()) {
+        CTxMemPool pool;
+        LOCK2(cs_main, pool.cs);
+        for (size_t i = txs.size() / 2; i < txs.size(); ++i)
+            AddTx(txs[i], pool);
+        for (size_t i = 0; i < txs.size() / 2; ++i)
+            AddTx(txs[i], pool);
+        pool.UpdateTransactionsFromBlock(disconnected);
+    }
+}
+
+BENCHMARK(MempoolChainWalks, 2);
+BENCHMARK(MempoolChainReorg, 2);
@@ -11,14 +11,24 @@
 #include <rpc/blockchain.h>
 
 #include <univalue.h>
+#include <univalue_builder.h>
 
-static void BlockToJsonVerbose(benchmark::State& state) {
+#include <string>
+#include <vector>
+
+static CBlock LoadBlock413567()
+{
     CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
     char a = '\0';
     stream.write(&a, 1); // Prevent compaction
 
     CBlock block;
     stream >> block;
+    return block;
+}
+
+static void BlockToJsonVerbose(benchmark::State& state) {
+    CBlock block = LoadBlock413567();
 
     CBlockIndex blockindex(block.GetHash());
     blockindex.nBits = 403014710;
@@ -28,4 +38,93 @@ static void BlockToJsonVerbose(benchmark::State& state) {
     }
 }
 
+// what getblock <hash> 2 does with it: build the reply and serialize it
+static void BlockToJsonVerboseWrite(benchmark::State& state) {
+    CBlock block = LoadBlock413567();
+
+    CBlockIndex blockindex(block.GetHash());
+    blockindex.nBits = 403014710;
+
+    while (state.KeepRunning()) {
+        (void)blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true).write();
+    }
+}
+
+// a reply object with many keys that are unique by construction (getrawmempool, getmempoolancestors),
+// filled with __pushKV as those RPCs do rather than with pushKV's search for an existing key
+static void UniValueLargeObject(benchmark::State& state) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 10000; i++)
+        keys.push_back("name" + std::to_string(i));
+
+    while (state.KeepRunning()) {
+        UniValue obj(UniValue::VOBJ);
+        for (const auto& key : keys)
+            obj.__pushKV(key, UniValue(UniValue::VARR));
+        assert(obj.size() == keys.size());
+    }
+}
+
+// a getblock <hash> 2 shaped reply, each transaction with its inputs and outputs, built by
+// copying every child into its parent as push_back and pushKV do, or by moving it in
+static UniValue NestedReply(bool move)
+{
+    UniValue txs(UniValue::VARR);
+    if (move)
+        UniValueReserve(txs, 2000);
+    for (int t = 0; t < 2000; t++) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("txid", std::string(64, 'a' + t % 6));
+        for (const char* key : {"vin", "vout"}) {
+            UniValue items(UniValue::VARR);
+            for (int i = 0; i < 3; i++) {
+                UniValue script(UniValue::VOBJ);
+                script.pushKV("asm", std::string(140, 'b'));
+                script.pushKV("hex", std::string(214, 'c'));
+                UniValue item(UniValue::VOBJ);
+                item.pushKV("n", i);
+                if (move) {
+                    PushKVMove(item, "scriptSig", std::move(script));
+                    PushBackMove(items, std::move(item));
+                } else {
+                    item.pushKV("scriptSig", script);
+                    items.push_back(item);
+                }
+            }
+            if (move)
+                PushKVMove(tx, key, std::move(items));
+            else
+                tx.pushKV(key, items);
+        }
+        if (move)
+            PushBackMove(txs, std::move(tx));
+        else
+            txs.push_back(tx);
+    }
+    UniValue result(UniValue::VOBJ);
+    if (move)
+        PushKVMove(result, "tx", std::move(txs));
+    else
+        result.pushKV("tx", txs);
+    return result;
+}
+
+static void UniValueNestedCopy(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        auto reply = NestedReply(false);
+        assert(reply["tx"].size() == 2000);
+    }
+}
+
+static void UniValueNestedMove(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        auto reply = NestedReply(true);
+        assert(reply["tx"].size() == 2000);
+    }
+}
+
 BENCHMARK(BlockToJsonVerbose, 10);
+BENCHMARK(BlockToJsonVerboseWrite, 10);
+BENCHMARK(UniValueLargeObject, 10);
+BENCHMARK(UniValueNestedCopy, 10);
+BENCHMARK(UniValueNestedMove, 10);
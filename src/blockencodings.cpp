@@ -8,23 +8,36 @@
 #include <chainparams.h>
 #include <crypto/sha256.h>
 #include <crypto/siphash.h>
+#include <nameclaim.h>
 #include <random.h>
 #include <streams.h>
 #include <txmempool.h>
 #include <validation.h>
 #include <util/system.h>
+#include <util/time.h>
 
 #include <unordered_map>
 
-CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
+BlockReconstructionStats g_block_reconstruction_stats;
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID, const std::vector<uint16_t>& prefill) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+        prefilledtxn(1), header(block) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
     prefilledtxn[0] = {0, block.vtx[0]};
+    shorttxids.reserve(block.vtx.size() - 1);
+    auto it = prefill.begin();
+    size_t last_prefilled = 0;
     for (size_t i = 1; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        if (it != prefill.end() && *it == i) {
+            // prefilled indexes are differentially encoded
+            prefilledtxn.push_back({uint16_t(i - last_prefilled - 1), block.vtx[i]});
+            last_prefilled = i;
+            ++it;
+            continue;
+        }
+        shorttxids.push_back(GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash()));
     }
 }
 
@@ -215,5 +228,58 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
         }
     }
 
+    BlockReconstructionInfo info;
+    info.blockhash = hash;
+    info.nTime = GetTime();
+    info.tx_count = block.vtx.size();
+    info.prefilled_count = prefilled_count;
+    info.mempool_count = mempool_count;
+    info.extra_count = extra_count;
+    info.requested.reserve(vtx_missing.size());
+    for (const auto& tx : vtx_missing) {
+        info.requested.push_back(tx->GetHash());
+        if (HasClaimOutputs(*tx))
+            info.requested_claim_count++;
+    }
+    g_block_reconstruction_stats.Add(std::move(info));
+
     return READ_STATUS_OK;
 }
+
+void BlockReconstructionStats::Add(BlockReconstructionInfo info)
+{
+    LOCK(cs);
+    blocks++;
+    if (!info.requested.empty())
+        blocks_with_requests++;
+    requested_txn += info.requested.size();
+    requested_claim_txn += info.requested_claim_count;
+    recent.push_back(std::move(info));
+    if (recent.size() > MAX_RECENT)
+        recent.pop_front();
+}
+
+std::vector<BlockReconstructionInfo> BlockReconstructionStats::GetRecent() const
+{
+    LOCK(cs);
+    return {recent.begin(), recent.end()};
+}
+
+void BlockReconstructionStats::GetTotals(uint64_t& blocks_out, uint64_t& blocks_with_requests_out, uint64_t& requested_txn_out, uint64_t& requested_claim_txn_out) const
+{
+    LOCK(cs);
+    blocks_out = blocks;
+    blocks_with_requests_out = blocks_with_requests;
+    requested_txn_out = requested_txn;
+    requested_claim_txn_out = requested_claim_txn;
+}
+
+bool HasClaimOutputs(const CTransaction& tx)
+{
+    int op;
+    std::vector<std::vector<unsigned char>> vvchParams;
+    for (const auto& txout : tx.vout)
+        if (DecodeClaimScript(txout.scriptPubKey, op, vvchParams))
+            return true;
+    return false;
+}
@@ -6,7 +6,9 @@
 #define BITCOIN_BLOCKENCODINGS_H
 
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <deque>
 #include <memory>
 
 class CTxMemPool;
@@ -148,7 +150,8 @@ public:
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
 
-    CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID);
+    // prefill holds ascending indexes of transactions to send in full besides the coinbase
+    CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID, const std::vector<uint16_t>& prefill = {});
 
     uint64_t GetShortID(const uint256& txhash) const;
 
@@ -209,4 +212,36 @@ public:
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
 
+/** How a single block was put together from a compact block announcement */
+struct BlockReconstructionInfo {
+    uint256 blockhash;
+    int64_t nTime = 0;
+    size_t tx_count = 0, prefilled_count = 0, mempool_count = 0, extra_count = 0;
+    size_t requested_claim_count = 0;
+    std::vector<uint256> requested; //!< txids we had to fetch with getblocktxn
+};
+
+/** Running totals and a window of recent compact block reconstructions */
+class BlockReconstructionStats {
+private:
+    mutable CCriticalSection cs;
+    std::deque<BlockReconstructionInfo> recent GUARDED_BY(cs);
+    uint64_t blocks GUARDED_BY(cs) = 0;
+    uint64_t blocks_with_requests GUARDED_BY(cs) = 0;
+    uint64_t requested_txn GUARDED_BY(cs) = 0;
+    uint64_t requested_claim_txn GUARDED_BY(cs) = 0;
+
+public:
+    static const size_t MAX_RECENT = 50;
+
+    void Add(BlockReconstructionInfo info);
+    std::vector<BlockReconstructionInfo> GetRecent() const;
+    void GetTotals(uint64_t& blocks_out, uint64_t& blocks_with_requests_out, uint64_t& requested_txn_out, uint64_t& requested_claim_txn_out) const;
+};
+
+extern BlockReconstructionStats g_block_reconstruction_stats;
+
+/** Whether a transaction creates, updates or supports a claim */
+bool HasClaimOutputs(const CTransaction& tx);
+
 #endif // BITCOIN_BLOCKENCODINGS_H
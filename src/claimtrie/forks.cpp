@@ -8,8 +8,75 @@
 #include <boost/locale/conversion.hpp>
 #include <boost/locale/localization_backend.hpp>
 
+#include <mutex>
+#include <unordered_map>
+
 #define logPrint CLogPrint::global()
 
+namespace
+{
+// two generations of name -> normalized name; when the young one fills up the old one is dropped,
+// so at most 2 * capacity entries are kept while recently used names survive the rotation
+class CNormalizationCache
+{
+public:
+    explicit CNormalizationCache(std::size_t capacity) : capacity(capacity)
+    {
+    }
+
+    bool find(const std::string& name, std::string& normalized)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = young.find(name);
+        if (it == young.end()) {
+            it = old.find(name);
+            if (it == old.end()) {
+                ++misses;
+                return false;
+            }
+            auto entry = std::move(*it);
+            old.erase(it);
+            it = promote(entry.first, std::move(entry.second));
+        }
+        ++hits;
+        normalized = it->second;
+        return true;
+    }
+
+    void insert(const std::string& name, const std::string& normalized)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        promote(name, normalized);
+    }
+
+    CNormalizationCacheStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {young.size() + old.size(), hits, misses};
+    }
+
+private:
+    using map_t = std::unordered_map<std::string, std::string>;
+
+    map_t::iterator promote(const std::string& name, std::string normalized)
+    {
+        if (young.size() >= capacity) {
+            old.clear();
+            old.swap(young);
+        }
+        return young.emplace(name, std::move(normalized)).first;
+    }
+
+    const std::size_t capacity;
+    std::mutex mutex;
+    map_t young, old;
+    uint64_t hits = 0, misses = 0;
+};
+
+// enough to hold every name touched by a normalization fork replay without rotating twice
+CNormalizationCache normalizationCache(1U << 18U);
+}
+
 CClaimTrieCacheExpirationFork::CClaimTrieCacheExpirationFork(CClaimTrie* base) : CClaimTrieCacheBase(base)
 {
     expirationHeight = nNextHeight;
@@ -84,7 +151,6 @@ bool CClaimTrieCacheExpirationFork::forkForExpirationChange(bool increment)
 
 CClaimTrieCacheNormalizationFork::CClaimTrieCacheNormalizationFork(CClaimTrie* base) : CClaimTrieCacheExpirationFork(base)
 {
-    db.define("NORMALIZED", [this](const std::string& str) { return normalizeClaimName(str, true); });
 }
 
 bool CClaimTrieCacheNormalizationFork::shouldNormalize() const
@@ -96,31 +162,39 @@ std::string CClaimTrieCacheNormalizationFork::normalizeClaimName(const std::stri
 {
     if (!force && !shouldNormalize())
         return name;
+    return normalizedName(name);
+}
 
-    static std::locale utf8;
-    static bool initialized = false;
-    if (!initialized) {
+std::string CClaimTrieCacheNormalizationFork::normalizedName(const std::string& name)
+{
+    std::string normalized;
+    if (normalizationCache.find(name, normalized))
+        return normalized;
+
+    // the UDF can be called from several connections at once; let the compiler guard the initialization
+    static const std::locale utf8 = []() {
         static boost::locale::localization_backend_manager manager =
             boost::locale::localization_backend_manager::global();
         manager.select("icu");
 
         static boost::locale::generator curLocale(manager);
-        utf8 = curLocale("en_US.UTF8");
-        initialized = true;
-    }
+        return curLocale("en_US.UTF8");
+    }();
 
-    std::string normalized;
     try {
         // Check if it is a valid utf-8 string. If not, it will throw a
         // boost::locale::conv::conversion_error exception which we catch later
         normalized = boost::locale::conv::to_utf<char>(name, "UTF-8", boost::locale::conv::stop);
-        if (normalized.empty())
+        if (normalized.empty()) {
+            normalizationCache.insert(name, name);
             return name;
+        }
 
         // these methods supposedly only use the "UTF8" portion of the locale object:
         normalized = boost::locale::normalize(normalized, boost::locale::norm_nfd, utf8);
         normalized = boost::locale::fold_case(normalized, utf8);
     } catch (const boost::locale::conv::conversion_error& e) {
+        normalizationCache.insert(name, name);
         return name;
     } catch (const std::bad_cast& e) {
         logPrint << "CClaimTrieCacheNormalizationFork::" << __func__ << "() is invalid or dependencies are missing: " << e.what() << Clog::endl;
@@ -130,9 +204,15 @@ std::string CClaimTrieCacheNormalizationFork::normalizeClaimName(const std::stri
         return name;
     }
 
+    normalizationCache.insert(name, normalized);
     return normalized;
 }
 
+CNormalizationCacheStats CClaimTrieCacheNormalizationFork::normalizationCacheStats()
+{
+    return normalizationCache.stats();
+}
+
 bool CClaimTrieCacheNormalizationFork::normalizeAllNamesInTrieIfNecessary()
 {
     ensureTransacting();
@@ -159,6 +239,9 @@ bool CClaimTrieCacheNormalizationFork::normalizeAllNamesInTrieIfNecessary()
     db << "UPDATE claim SET activationHeight = ?1 " // force a takeover on these
           "WHERE updateHeight < ?1 AND activationHeight > ?1 AND nodeName != name" << nNextHeight;
 
+    auto stats = normalizationCacheStats();
+    logPrint << "Normalization cache after fork: " << stats.entries << " entries, "
+             << stats.hits << " hits, " << stats.misses << " misses" << Clog::endl;
     return true;
 }
 
@@ -213,6 +296,20 @@ CClaimSupportToName CClaimTrieCacheNormalizationFork::getClaimsForName(const std
     return CClaimTrieCacheExpirationFork::getClaimsForName(normalizeClaimName(name));
 }
 
+CClaimSupportToName CClaimTrieCacheNormalizationFork::getClaimForNameByRank(const std::string& name, int rank,
+                                                                           bool bySequence, int& bid, int& seq) const
+{
+    return CClaimTrieCacheExpirationFork::getClaimForNameByRank(normalizeClaimName(name), rank, bySequence, bid, seq);
+}
+
+CClaimSupportToName CClaimTrieCacheNormalizationFork::getClaimsForNameAt(const std::string& name, int height) const
+{
+    // claims that lived through the fork have had their node renamed since; before it, node names were the names
+    if (height + 1 > base->nNormalizedNameForkHeight)
+        return archivedClaimsForName(normalizedName(name), height, true);
+    return archivedClaimsForName(name, height, false);
+}
+
 int CClaimTrieCacheNormalizationFork::getDelayForName(const std::string& name, const uint160& claimId) const
 {
     return CClaimTrieCacheExpirationFork::getDelayForName(normalizeClaimName(name), claimId);
@@ -4,6 +4,15 @@
 
 #include <trie.h>
 
+#include <cstdint>
+
+struct CNormalizationCacheStats
+{
+    std::size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+};
+
 class CClaimTrieCacheExpirationFork : public CClaimTrieCacheBase
 {
 public:
@@ -35,6 +44,10 @@ public:
     // lower-case and normalize any input string name
     // see: https://unicode.org/reports/tr15/#Norm_Forms
     std::string normalizeClaimName(const std::string& name, bool force = false) const; // public only for validating name field on update op
+    static std::string normalizedName(const std::string& name); // normalizeClaimName regardless of height, as NORMALIZED() in SQL
+
+    // results of normalizeClaimName are memoized process-wide, NORMALIZED() included
+    static CNormalizationCacheStats normalizationCacheStats();
 
     bool incrementBlock() override;
     bool decrementBlock() override;
@@ -43,6 +56,9 @@ public:
     bool getInfoForName(const std::string& name, CClaimValue& claim, int heightOffset = 0) override;
 
     CClaimSupportToName getClaimsForName(const std::string& name) const override;
+    CClaimSupportToName getClaimForNameByRank(const std::string& name, int rank, bool bySequence,
+                                              int& bid, int& seq) const override;
+    CClaimSupportToName getClaimsForNameAt(const std::string& name, int height) const override;
     std::string adjustNameForValidHeight(const std::string& name, int validHeight) const override;
 
 protected:
@@ -6,6 +6,7 @@
 #include <trie.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <memory>
 
 #define logPrint CLogPrint::global()
@@ -37,9 +38,11 @@ static const sqlite::sqlite_config sharedConfig {
     nullptr, sqlite::Encoding::UTF8
 };
 
-void applyPragmas(sqlite::database& db, std::size_t cache)
+void applyPragmas(sqlite::database& db, std::size_t cache, std::size_t mmap)
 {
     db << "PRAGMA cache_size=-" + std::to_string(cache); // in -KB
+    if (mmap > 0) // in bytes; pages are then read straight from the OS page cache instead of copied out of it
+        db << "PRAGMA mmap_size=" + std::to_string(mmap);
     db << "PRAGMA temp_store=MEMORY";
     db << "PRAGMA case_sensitive_like=true";
     db << "PRAGMA journal_mode=WAL";
@@ -47,6 +50,125 @@ void applyPragmas(sqlite::database& db, std::size_t cache)
     db << "PRAGMA wal_autocheckpoint=4000"; // 4k page size * 4000 = 16MB
 }
 
+bool changePageSize(sqlite::database& db, const std::string& file, int pageSize)
+{
+    // db has to be the only connection to file; it's reopened when the page size changes
+    if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)) != 0 || file == ":memory:")
+        return false;
+
+    int current = 0, pages = 0;
+    db << "PRAGMA page_size" >> current;
+    if (current == pageSize)
+        return false;
+
+    db << "PRAGMA page_count" >> pages;
+    if (pages == 0) { // nothing written yet; applies as soon as something is
+        db << "PRAGMA page_size=" + std::to_string(pageSize);
+        return true;
+    }
+
+    // the page size of a WAL database can't be changed in place, so make a compacted copy
+    // (readable throughout), convert that, and swap it in for the original
+    logPrint << "Converting " << file << " from " << current << " to " << pageSize << " byte pages" << Clog::endl;
+    const auto copy = file + ".vacuum";
+    std::remove(copy.c_str());
+    try {
+        // our strings are bound as blobs, which VACUUM INTO won't take, so quote it ourselves
+        std::string quoted;
+        for (auto c : copy)
+            quoted.append(c == '\'' ? 2 : 1, c);
+        db << "VACUUM INTO '" + quoted + "'";
+        sqlite::database converted(copy, sharedConfig);
+        converted << "PRAGMA journal_mode=DELETE";
+        converted << "PRAGMA page_size=" + std::to_string(pageSize);
+        converted << "VACUUM";
+    } catch (const sqlite::sqlite_exception& e) {
+        logPrint << "ERROR in " << __func__ << "(): " << e.what() << Clog::endl;
+        std::remove(copy.c_str());
+        return false;
+    }
+
+    db = sqlite::database(":memory:"); // closing the last connection checkpoints and removes the WAL
+    std::remove((file + "-wal").c_str());
+    std::remove((file + "-shm").c_str());
+    auto renamed = std::rename(copy.c_str(), file.c_str()) == 0;
+    if (!renamed) {
+        logPrint << "ERROR in " << __func__ << "(): unable to replace " << file << Clog::endl;
+        std::remove(copy.c_str());
+    }
+    db = sqlite::database(file, sharedConfig);
+    return renamed;
+}
+
+CWalCheckpointer::CWalCheckpointer(sqlite::database& writer, const std::string& file, std::size_t walBudgetBytes)
+    : writerConnection(writer.connection().get()), walBudget(walBudgetBytes), pageSize(4096), db(file, sharedConfig), pending(false), stop(false)
+{
+    writer << "PRAGMA wal_autocheckpoint=0"; // that's our job now
+    writer << "PRAGMA page_size" >> pageSize;
+    db << "PRAGMA synchronous=NORMAL"; // sync the database file once a checkpoint has filled it in
+    sqlite3_busy_timeout(db.connection().get(), 1000);
+    thread = std::thread(&CWalCheckpointer::loop, this);
+    sqlite3_wal_hook(writerConnection, &CWalCheckpointer::committed, this);
+}
+
+CWalCheckpointer::~CWalCheckpointer()
+{
+    sqlite3_wal_hook(writerConnection, nullptr, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+bool CWalCheckpointer::sync()
+{
+    // the writer commits without syncing; once its WAL is on disk, so is every commit in it
+    sqlite3_file* wal = nullptr;
+    auto code = sqlite3_file_control(writerConnection, "main", SQLITE_FCNTL_JOURNAL_POINTER, &wal);
+    if (code == SQLITE_OK && wal && wal->pMethods)
+        code = wal->pMethods->xSync(wal, SQLITE_SYNC_NORMAL);
+    return code == SQLITE_OK;
+}
+
+int CWalCheckpointer::committed(void* self, sqlite3* connection, const char*, int frames)
+{
+    // called on the writer, just after it commits and so holding no lock: only truncate from here,
+    // where the writer has nothing else to do. The writer has no busy handler, so with readers still
+    // on older frames this gives up on them at once and copies what it can, to try again next commit
+    auto checkpointer = static_cast<CWalCheckpointer*>(self);
+    if (std::size_t(frames) * checkpointer->pageSize > checkpointer->walBudget) {
+        sqlite3_wal_checkpoint_v2(connection, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+        return SQLITE_OK;
+    }
+    {
+        std::lock_guard<std::mutex> lock(checkpointer->mutex);
+        checkpointer->pending = true;
+    }
+    checkpointer->wake.notify_all();
+    return SQLITE_OK;
+}
+
+void CWalCheckpointer::loop()
+{
+    auto connection = db.connection().get();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        wake.wait_for(lock, std::chrono::seconds(1), [this]() { return stop || pending; });
+        if (stop)
+            break;
+        pending = false;
+        lock.unlock();
+
+        // PASSIVE never takes the write lock nor waits on readers, so the writer can't be held up by it
+        sqlite3_wal_checkpoint_v2(connection, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+
+        lock.lock();
+    }
+}
+
 CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
                        const std::string& dataDir,
                        int nNormalizedNameForkHeight,
@@ -56,7 +178,13 @@ CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
                        int64_t nExtendedClaimExpirationTime,
                        int64_t nExtendedClaimExpirationForkHeight,
                        int64_t nAllClaimsInMerkleForkHeight,
-                       int proportionalDelayFactor) :
+                       int proportionalDelayFactor,
+                       int takeoverHistoryWindow,
+                       int prefetchDepth,
+                       std::size_t mmapBytes,
+                       int pageSize,
+                       std::size_t walBudgetBytes,
+                       bool archive) :
                        nNextHeight(height),
                        dbCacheBytes(cacheBytes),
                        dbFile(dataDir + "/claims.sqlite"), db(dbFile, sharedConfig),
@@ -67,9 +195,20 @@ CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
                        nOriginalClaimExpirationTime(nOriginalClaimExpirationTime),
                        nExtendedClaimExpirationTime(nExtendedClaimExpirationTime),
                        nExtendedClaimExpirationForkHeight(nExtendedClaimExpirationForkHeight),
-                       nAllClaimsInMerkleForkHeight(nAllClaimsInMerkleForkHeight)
+                       nAllClaimsInMerkleForkHeight(nAllClaimsInMerkleForkHeight),
+                       nTakeoverHistoryWindow(takeoverHistoryWindow),
+                       nPrefetchDepth(prefetchDepth),
+                       fArchive(archive),
+                       nPrefetchTarget(0), nPrefetchedHeight(0), fPrefetchStop(false)
 {
-    applyPragmas(db, cacheBytes >> 10U); // in KB
+    changePageSize(db, dbFile, pageSize);
+    // all caches share this connection, so this is the one place to set it up
+    applyPragmas(db, cacheBytes >> 10U, mmapBytes); // in KB
+    db.define("POPS", [](std::string s) -> std::string { if (!s.empty()) s.pop_back(); return s; });
+    db.define("REVERSE", [](std::vector<uint8_t> s) -> std::vector<uint8_t> { std::reverse(s.begin(), s.end()); return s; });
+    db.define("NORMALIZED", [](const std::string& str) { return CClaimTrieCacheNormalizationFork::normalizedName(str); });
+    if (walBudgetBytes > 0)
+        checkpointer = std::make_unique<CWalCheckpointer>(db, dbFile, walBudgetBytes);
 
     db << "CREATE TABLE IF NOT EXISTS node (name BLOB NOT NULL PRIMARY KEY, "
           "parent BLOB REFERENCES node(name) DEFERRABLE INITIALLY DEFERRED, "
@@ -89,11 +228,59 @@ CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
     db << "CREATE TABLE IF NOT EXISTS takeover (name BLOB NOT NULL, height INTEGER NOT NULL, "
           "claimID BLOB, PRIMARY KEY(name, height DESC));";
 
+    // superseded takeovers that fell out of the history window; not read when connecting blocks
+    db << "CREATE TABLE IF NOT EXISTS takeover_archive (name BLOB NOT NULL, height INTEGER NOT NULL, "
+          "claimID BLOB, PRIMARY KEY(name, height DESC));";
+
     if (fWipe) {
         db << "DELETE FROM node";
         db << "DELETE FROM claim";
         db << "DELETE FROM support";
         db << "DELETE FROM takeover";
+        db << "DELETE FROM takeover_archive";
+    }
+
+    if (fArchive) {
+        // rows leave these when spent; the state of older blocks is the live rows plus these
+        db << "CREATE TABLE IF NOT EXISTS claim_archive (claimID BLOB NOT NULL, name BLOB NOT NULL, "
+              "nodeName BLOB NOT NULL, txID BLOB NOT NULL, txN INTEGER NOT NULL, originalHeight INTEGER NOT NULL, "
+              "updateHeight INTEGER NOT NULL, validHeight INTEGER NOT NULL, activationHeight INTEGER NOT NULL, "
+              "expirationHeight INTEGER NOT NULL, amount INTEGER NOT NULL, removalHeight INTEGER NOT NULL, "
+              "PRIMARY KEY(txID, txN));";
+
+        db << "CREATE TABLE IF NOT EXISTS support_archive (txID BLOB NOT NULL, txN INTEGER NOT NULL, "
+              "supportedClaimID BLOB NOT NULL, name BLOB NOT NULL, nodeName BLOB NOT NULL, "
+              "blockHeight INTEGER NOT NULL, validHeight INTEGER NOT NULL, activationHeight INTEGER NOT NULL, "
+              "expirationHeight INTEGER NOT NULL, amount INTEGER NOT NULL, removalHeight INTEGER NOT NULL, "
+              "PRIMARY KEY(txID, txN));";
+
+        // the first height the archive is complete from; set on the first load
+        db << "CREATE TABLE IF NOT EXISTS archive_start (height INTEGER NOT NULL)";
+
+        if (fWipe) {
+            db << "DELETE FROM claim_archive";
+            db << "DELETE FROM support_archive";
+            db << "DELETE FROM archive_start";
+        }
+        db << "INSERT INTO archive_start SELECT 0 WHERE NOT EXISTS (SELECT 1 FROM archive_start) "
+              "AND NOT EXISTS (SELECT 1 FROM claim) AND NOT EXISTS (SELECT 1 FROM support)";
+
+        db << "CREATE INDEX IF NOT EXISTS claim_archive_nodeName ON claim_archive (nodeName)";
+        db << "CREATE INDEX IF NOT EXISTS claim_archive_name ON claim_archive (name)";
+        db << "CREATE INDEX IF NOT EXISTS claim_archive_removalHeight ON claim_archive (removalHeight)";
+        db << "CREATE INDEX IF NOT EXISTS support_archive_nodeName ON support_archive (nodeName)";
+        db << "CREATE INDEX IF NOT EXISTS support_archive_name ON support_archive (name)";
+        db << "CREATE INDEX IF NOT EXISTS support_archive_removalHeight ON support_archive (removalHeight)";
+        // names from before the normalization fork are matched on the original name
+        db << "CREATE INDEX IF NOT EXISTS claim_name ON claim (name)";
+        db << "CREATE INDEX IF NOT EXISTS support_name ON support (name)";
+    } else {
+        // anything spent from here on would be missing from it
+        db << "DROP TABLE IF EXISTS claim_archive";
+        db << "DROP TABLE IF EXISTS support_archive";
+        db << "DROP TABLE IF EXISTS archive_start";
+        db << "DROP INDEX IF EXISTS claim_name";
+        db << "DROP INDEX IF EXISTS support_name";
     }
 
     db << "CREATE INDEX IF NOT EXISTS node_hash_len_name ON node (hash, LENGTH(name) DESC)";
@@ -101,6 +288,7 @@ CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
     db << "CREATE INDEX IF NOT EXISTS node_parent ON node (parent)";
 
     db << "CREATE INDEX IF NOT EXISTS takeover_height ON takeover (height)";
+    db << "CREATE INDEX IF NOT EXISTS takeover_archive_height ON takeover_archive (height)";
 
     db << "CREATE INDEX IF NOT EXISTS claim_activationHeight ON claim (activationHeight)";
     db << "CREATE INDEX IF NOT EXISTS claim_expirationHeight ON claim (expirationHeight)";
@@ -114,15 +302,115 @@ CClaimTrie::CClaimTrie(std::size_t cacheBytes, bool fWipe, int height,
     db << "INSERT OR IGNORE INTO node(name, hash) VALUES(x'', ?)" << emptyTrieHash; // ensure that we always have our root node
 }
 
+CClaimTrie::~CClaimTrie()
+{
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        fPrefetchStop = true;
+    }
+    prefetchSignal.notify_all();
+    if (prefetchThread.joinable())
+        prefetchThread.join();
+}
+
+void CClaimTrie::prefetch(int nextHeight)
+{
+    if (nPrefetchDepth <= 0) return;
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        if (!strPrefetchError.empty()) {
+            logPrint << "ERROR in CClaimTrie::prefetchLoop(): " << strPrefetchError << Clog::endl;
+            strPrefetchError.clear();
+        }
+        if (!prefetchThread.joinable())
+            prefetchThread = std::thread(&CClaimTrie::prefetchLoop, this);
+        nPrefetchTarget = nextHeight + nPrefetchDepth;
+        // heights below the tip are of no use anymore; after a reorg the ones above it are still warm
+        if (nPrefetchedHeight < nextHeight - 1)
+            nPrefetchedHeight = nextHeight - 1;
+    }
+    prefetchSignal.notify_one();
+}
+
+int CClaimTrie::prefetchedHeight()
+{
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    return nPrefetchedHeight;
+}
+
+static const sqlite::sqlite_config readOnlyConfig {
+    sqlite::OpenFlags::READONLY, nullptr, sqlite::Encoding::UTF8
+};
+
+void CClaimTrie::prefetchLoop()
+{
+    // a connection of our own so that we never wait on (or hold up) the one connecting blocks;
+    // what we read stays in the OS page cache for the writer to find
+    std::unique_ptr<sqlite::database> connection;
+    try {
+        connection = std::make_unique<sqlite::database>(dbFile, readOnlyConfig);
+        *connection << "PRAGMA cache_size=-2000"; // in -KB
+        *connection << "PRAGMA case_sensitive_like=true";
+        connection->define("POPS", [](std::string s) -> std::string { if (!s.empty()) s.pop_back(); return s; });
+    } catch (const sqlite::sqlite_exception& e) {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        strPrefetchError = e.what();
+        return;
+    }
+    auto& reader = *connection;
+
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    while (!fPrefetchStop) {
+        if (nPrefetchedHeight >= nPrefetchTarget) {
+            prefetchSignal.wait(lock);
+            continue;
+        }
+        const int height = nPrefetchedHeight + 1;
+        lock.unlock();
+        try {
+            // the same rows incrementBlock is going to look at for this height
+            std::vector<std::string> names;
+            reader << "SELECT nodeName FROM claim INDEXED BY claim_activationHeight WHERE activationHeight = ?1 "
+                      "UNION SELECT nodeName FROM claim INDEXED BY claim_expirationHeight WHERE expirationHeight = ?1 "
+                      "UNION SELECT nodeName FROM support INDEXED BY support_activationHeight WHERE activationHeight = ?1 "
+                      "UNION SELECT nodeName FROM support INDEXED BY support_expirationHeight WHERE expirationHeight = ?1"
+                   << height
+                   >> [&names](std::string name) {
+                       names.push_back(std::move(name));
+                   };
+            // and for each of their names: the node with its ancestors (rehashed), all of its claims
+            // and supports (needed to find the winner) and its takeover history
+            if (!names.empty()) {
+                auto touchQuery = reader << "SELECT (SELECT COUNT(hash) FROM node WHERE name IN (WITH RECURSIVE "
+                                            "prefix(p) AS (VALUES(?1) UNION ALL SELECT POPS(p) FROM prefix WHERE p != x'') "
+                                            "SELECT p FROM prefix)), "
+                                            "(SELECT SUM(amount) FROM claim WHERE nodeName = ?1), "
+                                            "(SELECT SUM(amount) FROM support WHERE nodeName = ?1), "
+                                            "(SELECT MAX(height) FROM takeover WHERE name = ?1)";
+                for (auto& name : names) {
+                    touchQuery << name;
+                    touchQuery++;
+                }
+            }
+            lock.lock();
+        } catch (const sqlite::sqlite_exception& e) {
+            lock.lock();
+            // the logger isn't thread safe; leave it for prefetch() to report
+            strPrefetchError = std::string(e.what()) + " at height " + std::to_string(height);
+        }
+        if (nPrefetchedHeight == height - 1) // not moved forward by prefetch() in the meantime
+            nPrefetchedHeight = height;
+    }
+}
+
 CClaimTrieCacheBase::~CClaimTrieCacheBase()
 {
     if (transacting) {
         db << "rollback";
         transacting = false;
     }
-    claimHashQuery.used(true);
-    childHashQuery.used(true);
-    claimHashQueryLimit.used(true);
+    if (statements)
+        base->releaseStatements(std::move(statements));
 }
 
 std::size_t CClaimTrie::cache()
@@ -133,6 +421,8 @@ std::size_t CClaimTrie::cache()
 bool CClaimTrie::SyncToDisk()
 {
     // alternatively, switch to full sync after we are caught up on the chain
+    if (checkpointer)
+        return checkpointer->sync();
     return sqlite::sync(db) == SQLITE_OK;
 }
 
@@ -161,11 +451,8 @@ bool CClaimTrieCacheBase::haveSupport(const std::string& name, const COutPoint&
     return query.begin() != query.end();
 }
 
-supportEntryType CClaimTrieCacheBase::getSupportsForName(const std::string& name) const
+static supportEntryType readSupports(sqlite::database_binder& query)
 {
-    // includes values that are not yet valid
-    auto query = db << "SELECT supportedClaimID, txID, txN, blockHeight, activationHeight, amount "
-                        "FROM support WHERE nodeName = ? AND expirationHeight >= ?" << name << nNextHeight;
     supportEntryType ret;
     for (auto&& row: query) {
         CSupportValue value;
@@ -176,6 +463,14 @@ supportEntryType CClaimTrieCacheBase::getSupportsForName(const std::string& name
     return ret;
 }
 
+supportEntryType CClaimTrieCacheBase::getSupportsForName(const std::string& name) const
+{
+    // includes values that are not yet valid
+    auto query = db << "SELECT supportedClaimID, txID, txN, blockHeight, activationHeight, amount "
+                        "FROM support WHERE nodeName = ? AND expirationHeight >= ?" << name << nNextHeight;
+    return readSupports(query);
+}
+
 bool CClaimTrieCacheBase::haveClaimInQueue(const std::string& name, const COutPoint& outPoint, int& nValidAtHeight) const
 {
     auto query = db << "SELECT activationHeight FROM claim WHERE nodeName = ? AND txID = ? AND txN = ? "
@@ -394,13 +689,10 @@ bool CClaimTrieCacheBase::getInfoForName(const std::string& name, CClaimValue& c
     return ret;
 }
 
-CClaimSupportToName CClaimTrieCacheBase::getClaimsForName(const std::string& name) const
+// claims from query (as selected by getClaimsForName) matched up with their supports, as of nextHeight
+static CClaimSupportToName matchSupports(const std::string& name, int nLastTakeoverHeight, int nextHeight,
+                                         sqlite::database_binder& query, supportEntryType supports)
 {
-    uint160 claimId;
-    int nLastTakeoverHeight = 0;
-    getLastTakeoverForName(name, claimId, nLastTakeoverHeight);
-
-    auto supports = getSupportsForName(name);
     auto find = [&supports](decltype(supports)::iterator& it, const CClaimValue& claim) {
         it = std::find_if(it, supports.end(), [&claim](const CSupportValue& support) {
             return claim.claimId == support.supportedClaimId;
@@ -408,10 +700,6 @@ CClaimSupportToName CClaimTrieCacheBase::getClaimsForName(const std::string& nam
         return it != supports.end();
     };
 
-    auto query = db << "SELECT claimID, txID, txN, originalHeight, updateHeight, activationHeight, amount "
-                        "FROM claim WHERE nodeName = ? AND expirationHeight >= ?"
-                    << name << nNextHeight;
-
     // match support to claim
     std::vector<CClaimNsupports> claimsNsupports;
     for (auto &&row: query) {
@@ -419,10 +707,10 @@ CClaimSupportToName CClaimTrieCacheBase::getClaimsForName(const std::string& nam
         int originalHeight;
         row >> claim.claimId >> claim.outPoint.hash >> claim.outPoint.n
             >> originalHeight >> claim.nHeight >> claim.nValidAtHeight >> claim.nAmount;
-        int64_t nAmount = claim.nValidAtHeight < nNextHeight ? claim.nAmount : 0;
+        int64_t nAmount = claim.nValidAtHeight < nextHeight ? claim.nAmount : 0;
         auto ic = claimsNsupports.emplace(claimsNsupports.end(), claim, nAmount, originalHeight);
         for (auto it = supports.begin(); find(it, claim); it = supports.erase(it)) {
-            if (it->nValidAtHeight < nNextHeight)
+            if (it->nValidAtHeight < nextHeight)
                 ic->effectiveAmount += it->nAmount;
             ic->supports.push_back(std::move(*it));
         }
@@ -432,6 +720,109 @@ CClaimSupportToName CClaimTrieCacheBase::getClaimsForName(const std::string& nam
     return {name, nLastTakeoverHeight, std::move(claimsNsupports), std::move(supports)};
 }
 
+CClaimSupportToName CClaimTrieCacheBase::getClaimsForName(const std::string& name) const
+{
+    uint160 claimId;
+    int nLastTakeoverHeight = 0;
+    getLastTakeoverForName(name, claimId, nLastTakeoverHeight);
+
+    auto supports = getSupportsForName(name);
+
+    auto query = db << "SELECT claimID, txID, txN, originalHeight, updateHeight, activationHeight, amount "
+                        "FROM claim WHERE nodeName = ? AND expirationHeight >= ?"
+                    << name << nNextHeight;
+
+    return matchSupports(name, nLastTakeoverHeight, nNextHeight, query, std::move(supports));
+}
+
+CClaimSupportToName CClaimTrieCacheBase::getClaimForNameByRank(const std::string& name, int rank, bool bySequence,
+                                                              int& bid, int& seq) const
+{
+    uint160 claimId;
+    int nLastTakeoverHeight = 0;
+    getLastTakeoverForName(name, claimId, nLastTakeoverHeight);
+
+    // both orders are those of matchSupports and seqSort: by bid, the biggest effective amount first, then the
+    // oldest update, then the lowest outpoint; by sequence, the oldest claim first, then the reverse of the bid order
+    auto query = db << "SELECT claimID, txID, txN, originalHeight, updateHeight, activationHeight, amount, "
+                       "effectiveAmount, bid, seq FROM (SELECT *, "
+                       "ROW_NUMBER() OVER (ORDER BY effectiveAmount DESC, updateHeight, txID, txN) - 1 AS bid, "
+                       "ROW_NUMBER() OVER (ORDER BY originalHeight, effectiveAmount, updateHeight DESC, "
+                       "txID DESC, txN DESC) - 1 AS seq FROM (SELECT c.*, "
+                       "(CASE WHEN c.activationHeight < ?2 THEN c.amount ELSE 0 END) + "
+                       "IFNULL((SELECT SUM(s.amount) FROM support s WHERE s.supportedClaimID = c.claimID "
+                       "AND s.nodeName = ?1 AND s.activationHeight < ?2 AND s.expirationHeight >= ?2), 0) "
+                       "AS effectiveAmount FROM claim c WHERE c.nodeName = ?1 AND c.expirationHeight >= ?2)) "
+                       "ORDER BY " + std::string(bySequence ? "seq" : "bid") + " LIMIT 1 OFFSET ?3"
+                    << name << nNextHeight << rank;
+
+    std::vector<CClaimNsupports> claimsNsupports;
+    for (auto&& row: query) {
+        CClaimValue claim;
+        int originalHeight;
+        int64_t effectiveAmount;
+        row >> claim.claimId >> claim.outPoint.hash >> claim.outPoint.n >> originalHeight >> claim.nHeight
+            >> claim.nValidAtHeight >> claim.nAmount >> effectiveAmount >> bid >> seq;
+        claim.nEffectiveAmount = effectiveAmount;
+
+        // includes values that are not yet valid, as getSupportsForName does
+        auto supportQuery = db << "SELECT supportedClaimID, txID, txN, blockHeight, activationHeight, amount "
+                                  "FROM support WHERE supportedClaimID = ? AND nodeName = ? AND expirationHeight >= ?"
+                               << claim.claimId << name << nNextHeight;
+        claimsNsupports.emplace_back(claim, effectiveAmount, originalHeight, readSupports(supportQuery));
+    }
+    return {name, nLastTakeoverHeight, std::move(claimsNsupports), {}};
+}
+
+bool CClaimTrieCacheBase::isArchived(int height) const
+{
+    if (!base->fArchive || height < 0 || height >= nNextHeight)
+        return false;
+    auto query = db << "SELECT height FROM archive_start";
+    auto it = query.begin();
+    if (it == query.end())
+        return false;
+    int start;
+    *it >> start;
+    return height >= start;
+}
+
+CClaimSupportToName CClaimTrieCacheBase::getClaimsForNameAt(const std::string& name, int height) const
+{
+    return archivedClaimsForName(name, height, true);
+}
+
+CClaimSupportToName CClaimTrieCacheBase::archivedClaimsForName(const std::string& name, int height, bool byNodeName) const
+{
+    // alive once block height was connected: added at or before it, and spent (if at all) after it;
+    // activation heights only ever move down to the height of a takeover, so they read the same as they did then
+    assert(isArchived(height));
+    const auto nextHeight = height + 1;
+    const std::string column = byNodeName ? "nodeName" : "name";
+
+    int nLastTakeoverHeight = 0;
+    auto takeoverQuery = db << "SELECT height FROM (SELECT height FROM takeover WHERE name = ?1 AND height < ?2 "
+                               "UNION ALL SELECT height FROM takeover_archive WHERE name = ?1 AND height < ?2) "
+                               "ORDER BY height DESC LIMIT 1" << name << nextHeight;
+    for (auto&& row: takeoverQuery)
+        row >> nLastTakeoverHeight;
+
+    auto supportQuery = db << "SELECT supportedClaimID, txID, txN, blockHeight, activationHeight, amount "
+                              "FROM support WHERE " + column + " = ?1 AND blockHeight < ?2 AND expirationHeight >= ?2 "
+                              "UNION ALL SELECT supportedClaimID, txID, txN, blockHeight, activationHeight, amount "
+                              "FROM support_archive WHERE " + column + " = ?1 AND blockHeight < ?2 "
+                              "AND expirationHeight >= ?2 AND removalHeight >= ?2" << name << nextHeight;
+    auto supports = readSupports(supportQuery);
+
+    auto query = db << "SELECT claimID, txID, txN, originalHeight, updateHeight, activationHeight, amount "
+                       "FROM claim WHERE " + column + " = ?1 AND updateHeight < ?2 AND expirationHeight >= ?2 "
+                       "UNION ALL SELECT claimID, txID, txN, originalHeight, updateHeight, activationHeight, amount "
+                       "FROM claim_archive WHERE " + column + " = ?1 AND updateHeight < ?2 "
+                       "AND expirationHeight >= ?2 AND removalHeight >= ?2" << name << nextHeight;
+
+    return matchSupports(name, nLastTakeoverHeight, nextHeight, query, std::move(supports));
+}
+
 void completeHash(uint256& partialHash, const std::string& key, int to)
 {
     for (auto it = key.rbegin(); std::distance(it, key.rend()) > to + 1; ++it)
@@ -510,9 +901,19 @@ bool CClaimTrieCacheBase::validateDb(int height, const uint256& rootHash)
             return false;
         }
 
+        if (base->fArchive) // older blocks had their spent claims deleted
+            db << "INSERT INTO archive_start SELECT ? WHERE NOT EXISTS (SELECT 1 FROM archive_start)" << height;
+
         if (nNextHeight > base->nAllClaimsInMerkleForkHeight) // index not used as part of sync:
             db << "CREATE UNIQUE INDEX IF NOT EXISTS claim_reverseClaimID ON claim (REVERSE(claimID))";
 
+        if (base->nTakeoverHistoryWindow > 0) {
+            // bring databases written without compaction (or with a larger window) up to date
+            ensureTransacting();
+            archiveAllTakeovers(nNextHeight - base->nTakeoverHistoryWindow);
+            return flush();
+        }
+
         return true;
     }
     return false;
@@ -530,6 +931,7 @@ bool CClaimTrieCacheBase::flush()
         transacting = false;
     }
     base->nNextHeight = nNextHeight;
+    base->prefetch(nNextHeight);
     removalWorkaround.clear();
     return true;
 }
@@ -553,29 +955,66 @@ extern const std::string proofClaimQuery_s =
     "SELECT POPS(p) FROM prefix WHERE p != x'') SELECT p FROM prefix) "
     "ORDER BY n.name";
 
+CClaimTrieStatements::CClaimTrieStatements(sqlite::database& db)
+    : childHashQuery(db << childHashQuery_s),
+      claimHashQuery(db << claimHashQuery_s),
+      claimHashQueryLimit(db << claimHashQueryLimit_s)
+{
+    // nothing to run until they're bound
+    childHashQuery.used(true);
+    claimHashQuery.used(true);
+    claimHashQueryLimit.used(true);
+}
+
+std::unique_ptr<CClaimTrieStatements> CClaimTrie::acquireStatements()
+{
+    {
+        std::lock_guard<std::mutex> lock(statementsMutex);
+        if (!idleStatements.empty()) {
+            auto statements = std::move(idleStatements.back());
+            idleStatements.pop_back();
+            return statements;
+        }
+    }
+    return std::make_unique<CClaimTrieStatements>(db);
+}
+
+void CClaimTrie::releaseStatements(std::unique_ptr<CClaimTrieStatements> statements)
+{
+    static const std::size_t maxIdleStatements = 8;
+    try {
+        // run each to completion (unbound, so on no rows) to drop any read lock it still holds
+        statements->childHashQuery++;
+        statements->claimHashQuery++;
+        statements->claimHashQueryLimit++;
+    } catch (const sqlite::sqlite_exception&) {
+        return; // not worth keeping
+    }
+    std::lock_guard<std::mutex> lock(statementsMutex);
+    if (idleStatements.size() < maxIdleStatements)
+        idleStatements.push_back(std::move(statements));
+}
+
 CClaimTrieCacheBase::CClaimTrieCacheBase(CClaimTrie* base)
     : base(base), db(base->db.connection()),
-      childHashQuery(db << childHashQuery_s),
-      claimHashQuery(db << claimHashQuery_s),
-      claimHashQueryLimit(db << claimHashQueryLimit_s),
+      statements(base->acquireStatements()),
+      childHashQuery(statements->childHashQuery),
+      claimHashQuery(statements->claimHashQuery),
+      claimHashQueryLimit(statements->claimHashQueryLimit),
       transacting(false)
 {
     assert(base);
     nNextHeight = base->nNextHeight;
-
-    applyPragmas(db, base->dbCacheBytes >> 10U); // in KB
-
-    db.define("POPS", [](std::string s) -> std::string { if (!s.empty()) s.pop_back(); return s; });
-    db.define("REVERSE", [](std::vector<uint8_t> s) -> std::vector<uint8_t> { std::reverse(s.begin(), s.end()); return s; });
 }
 
 CClaimTrieCacheBase::CClaimTrieCacheBase(CClaimTrieCacheBase&& o)
     : nNextHeight(o.nNextHeight),
       base(o.base), db(std::move(o.db)),
       removalWorkaround(std::move(o.removalWorkaround)),
-      childHashQuery(std::move(o.childHashQuery)),
-      claimHashQuery(std::move(o.claimHashQuery)),
-      claimHashQueryLimit(std::move(o.claimHashQueryLimit)),
+      statements(std::move(o.statements)),
+      childHashQuery(statements->childHashQuery),
+      claimHashQuery(statements->claimHashQuery),
+      claimHashQueryLimit(statements->claimHashQueryLimit),
       transacting(o.transacting)
 {
     o.transacting = false;
@@ -711,6 +1150,9 @@ bool CClaimTrieCacheBase::removeClaim(const uint160& claimId, const COutPoint& o
         return false;
 
     *it >> nodeName >> validHeight >> originalHeight;
+    if (base->fArchive)
+        db << "INSERT OR REPLACE INTO claim_archive SELECT *, ? FROM claim WHERE claimID = ? AND txID = ? and txN = ?"
+           << nNextHeight << claimId << outPoint.hash << outPoint.n;
     db  << "DELETE FROM claim WHERE claimID = ? AND txID = ? and txN = ?" << claimId << outPoint.hash << outPoint.n;
     if (!db.rows_modified())
         return false;
@@ -743,6 +1185,9 @@ bool CClaimTrieCacheBase::removeSupport(const COutPoint& outPoint, std::string&
     }
     ensureTransacting();
 
+    if (base->fArchive)
+        db << "INSERT OR REPLACE INTO support_archive SELECT *, ? FROM support WHERE txID = ? AND txN = ?"
+           << nNextHeight << outPoint.hash << outPoint.n;
     db << "DELETE FROM support WHERE txID = ? AND txN = ?" << outPoint.hash << outPoint.n;
     if (!db.rows_modified())
         return false;
@@ -774,6 +1219,9 @@ bool CClaimTrieCacheBase::incrementBlock()
 
     insertTakeovers();
 
+    if (base->nTakeoverHistoryWindow > 0)
+        archiveTakeovers(nNextHeight - base->nTakeoverHistoryWindow);
+
     nNextHeight++;
     return true;
 }
@@ -821,6 +1269,66 @@ void CClaimTrieCacheBase::insertTakeovers(bool allowReplace) {
     insertTakeoverQuery.used(true);
 }
 
+void CClaimTrieCacheBase::archiveTakeovers(int height)
+{
+    // a takeover at the given height just left the history window; every older takeover for that name
+    // has been superseded by it, so those rows are only needed for deep reorgs and historical lookups.
+    // takeovers at fork heights stay put as the forks replay against them
+    if (height <= 0)
+        return;
+
+    db << "INSERT OR REPLACE INTO takeover_archive(name, height, claimID) "
+          "SELECT name, height, claimID FROM takeover WHERE name IN "
+          "(SELECT name FROM takeover WHERE height = ?1) AND height < ?1 AND height NOT IN (?2, ?3, ?4)"
+          << height << base->nNormalizedNameForkHeight << base->nExtendedClaimExpirationForkHeight
+          << base->nAllClaimsInMerkleForkHeight;
+
+    db << "DELETE FROM takeover WHERE name IN "
+          "(SELECT name FROM takeover WHERE height = ?1) AND height < ?1 AND height NOT IN (?2, ?3, ?4)"
+          << height << base->nNormalizedNameForkHeight << base->nExtendedClaimExpirationForkHeight
+          << base->nAllClaimsInMerkleForkHeight;
+}
+
+void CClaimTrieCacheBase::archiveAllTakeovers(int height)
+{
+    // same as above but for every name at once; the newest takeover at or below height is kept
+    if (height <= 0)
+        return;
+
+    db << "INSERT OR REPLACE INTO takeover_archive(name, height, claimID) "
+          "SELECT t.name, t.height, t.claimID FROM takeover t WHERE t.height < "
+          "(SELECT MAX(m.height) FROM takeover m WHERE m.name = t.name AND m.height <= ?1) "
+          "AND t.height NOT IN (?2, ?3, ?4)"
+          << height << base->nNormalizedNameForkHeight << base->nExtendedClaimExpirationForkHeight
+          << base->nAllClaimsInMerkleForkHeight;
+
+    db << "DELETE FROM takeover WHERE EXISTS (SELECT 1 FROM takeover_archive a "
+          "WHERE a.name = takeover.name AND a.height = takeover.height)";
+}
+
+void CClaimTrieCacheBase::restoreArchivedTakeovers()
+{
+    // names with takeovers about to be undone need their previous takeover back
+    // if it was archived (the undo went deeper than the history window)
+    std::vector<std::string> names;
+    db  << "SELECT DISTINCT name FROM takeover WHERE height >= ?" << nNextHeight
+        >> [&names](std::string name) {
+            names.push_back(std::move(name));
+        };
+
+    for (auto& name : names) {
+        db << "INSERT INTO takeover(name, height, claimID) SELECT name, height, claimID FROM takeover_archive "
+              "WHERE name = ?1 AND height < ?2 AND height > "
+              "IFNULL((SELECT MAX(height) FROM takeover WHERE name = ?1 AND height < ?2), -1) "
+              "ORDER BY height DESC LIMIT 1" << name << nNextHeight;
+        if (db.rows_modified() > 0)
+            db << "DELETE FROM takeover_archive WHERE name = ?1 AND height = "
+                  "(SELECT MAX(height) FROM takeover WHERE name = ?1 AND height < ?2)" << name << nNextHeight;
+    }
+
+    db << "DELETE FROM takeover_archive WHERE height >= ?" << nNextHeight;
+}
+
 bool CClaimTrieCacheBase::activateAllFor(const std::string& name)
 {
     // now that we know a takeover is happening, we bring everybody in:
@@ -866,8 +1374,17 @@ bool CClaimTrieCacheBase::finalizeDecrement()
           "UNION SELECT nodeName FROM support WHERE activationHeight = ?1 AND expirationHeight > ?1 "
           "UNION SELECT name FROM takeover WHERE height = ?1)" << nNextHeight;
 
+    if (base->nTakeoverHistoryWindow > 0)
+        restoreArchivedTakeovers();
+
     db << "DELETE FROM takeover WHERE height >= ?" << nNextHeight;
 
+    if (base->fArchive) {
+        // whatever was spent in the undone blocks is live again (or was never there)
+        db << "DELETE FROM claim_archive WHERE removalHeight >= ?" << nNextHeight;
+        db << "DELETE FROM support_archive WHERE removalHeight >= ?" << nNextHeight;
+    }
+
     return true;
 }
 
@@ -6,16 +6,57 @@
 #include <txoutpoint.h>
 #include <uints.h>
 
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_set>
 #include <utility>
 
-void applyPragmas(sqlite::database& db, std::size_t cache);
+void applyPragmas(sqlite::database& db, std::size_t cache, std::size_t mmap = 0);
+bool changePageSize(sqlite::database& db, const std::string& file, int pageSize);
 uint256 getValueHash(const COutPoint& outPoint, int nHeightOfLastTakeover);
 
+/**
+ * Checkpoints the WAL of one database so the connection writing to it rarely has to:
+ * PASSIVE checkpoints run continuously from a thread and connection of their own, and
+ * only once the WAL outgrows its budget does the writer truncate it, right after a commit.
+ * Nothing here ever holds the write lock while it waits on readers.
+ */
+class CWalCheckpointer
+{
+public:
+    CWalCheckpointer(sqlite::database& writer, const std::string& file, std::size_t walBudgetBytes);
+    ~CWalCheckpointer();
+
+    // make everything committed so far durable by syncing the WAL; checkpoints carry on in the background
+    bool sync();
+
+private:
+    sqlite3* const writerConnection;
+    const std::size_t walBudget;
+    int pageSize;
+    sqlite::database db;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool pending;
+    bool stop;
+    std::thread thread;
+
+    static int committed(void* self, sqlite3* connection, const char* schema, int frames);
+    void loop();
+};
+
+/** The statements every claimtrie cache needs, pooled by CClaimTrie so each is only prepared once */
+struct CClaimTrieStatements
+{
+    explicit CClaimTrieStatements(sqlite::database& db);
+    sqlite::database_binder childHashQuery, claimHashQuery, claimHashQueryLimit;
+};
+
 class CClaimTrie
 {
     friend class CClaimTrieCacheBase;
@@ -38,7 +79,15 @@ public:
                int64_t nExtendedClaimExpirationTime = 1,
                int64_t nExtendedClaimExpirationForkHeight = 1,
                int64_t nAllClaimsInMerkleForkHeight = 1,
-               int proportionalDelayFactor = 32);
+               int proportionalDelayFactor = 32,
+               int takeoverHistoryWindow = 0,
+               int prefetchDepth = 0,
+               std::size_t mmapBytes = 0,
+               int pageSize = 0,
+               std::size_t walBudgetBytes = 0,
+               bool archive = false);
+
+    ~CClaimTrie();
 
     CClaimTrie& operator=(CClaimTrie&&) = delete;
     CClaimTrie& operator=(const CClaimTrie&) = delete;
@@ -47,6 +96,9 @@ public:
     bool SyncToDisk();
     std::size_t cache();
 
+    void prefetch(int nextHeight);
+    int prefetchedHeight();
+
 protected:
     int nNextHeight;
     const std::size_t dbCacheBytes;
@@ -61,6 +113,27 @@ protected:
     const int64_t nExtendedClaimExpirationTime;
     const int64_t nExtendedClaimExpirationForkHeight;
     const int64_t nAllClaimsInMerkleForkHeight;
+    const int nTakeoverHistoryWindow; // 0 keeps all takeovers in the takeover table
+    const int nPrefetchDepth; // blocks ahead of the tip to read into the page cache; 0 disables it
+    const bool fArchive; // keep spent claims and supports, with the height they were spent at
+
+private:
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchSignal;
+    std::thread prefetchThread;
+    int nPrefetchTarget, nPrefetchedHeight;
+    bool fPrefetchStop;
+    std::string strPrefetchError;
+
+    void prefetchLoop();
+
+    std::unique_ptr<CWalCheckpointer> checkpointer; // none: the writer checkpoints, SyncToDisk blocks on it
+
+    std::mutex statementsMutex;
+    std::vector<std::unique_ptr<CClaimTrieStatements>> idleStatements;
+
+    std::unique_ptr<CClaimTrieStatements> acquireStatements();
+    void releaseStatements(std::unique_ptr<CClaimTrieStatements> statements);
 };
 
 class CClaimTrieCacheBase
@@ -106,8 +179,15 @@ public:
     virtual bool getProofForName(const std::string& name, const uint160& claim, CClaimTrieProof& proof);
 
     virtual CClaimSupportToName getClaimsForName(const std::string& name) const;
+    // the one claim at rank in bid (or sequence) order, with its supports and its rank in the other order
+    virtual CClaimSupportToName getClaimForNameByRank(const std::string& name, int rank, bool bySequence,
+                                                      int& bid, int& seq) const;
     virtual std::string adjustNameForValidHeight(const std::string& name, int validHeight) const;
 
+    // archive mode: claims as of any block height since archiving began, without rolling back
+    bool isArchived(int height) const;
+    virtual CClaimSupportToName getClaimsForNameAt(const std::string& name, int height) const;
+
     void getNamesInTrie(std::function<void(const std::string&)> callback) const;
     bool getLastTakeoverForName(const std::string& name, uint160& claimId, int& takeoverHeight) const;
     bool findNameForClaim(std::vector<unsigned char> claim, CClaimValue& value, std::string& name) const;
@@ -122,10 +202,12 @@ protected:
     CClaimTrie* base;
     sqlite::database db;
     mutable std::unordered_set<std::string> removalWorkaround;
-    sqlite::database_binder childHashQuery, claimHashQuery, claimHashQueryLimit;
+    std::unique_ptr<CClaimTrieStatements> statements; // on loan from base
+    sqlite::database_binder &childHashQuery, &claimHashQuery, &claimHashQueryLimit;
 
     virtual uint256 computeNodeHash(const std::string& name, int takeoverHeight);
     supportEntryType getSupportsForName(const std::string& name) const;
+    CClaimSupportToName archivedClaimsForName(const std::string& name, int height, bool byNodeName) const;
 
     virtual int getDelayForName(const std::string& name, const uint160& claimId) const;
 
@@ -133,6 +215,9 @@ protected:
     void ensureTreeStructureIsUpToDate();
     void ensureTransacting();
     void insertTakeovers(bool allowReplace=false);
+    void archiveTakeovers(int height);
+    void archiveAllTakeovers(int height);
+    void restoreArchivedTakeovers();
 
 private:
     bool transacting;
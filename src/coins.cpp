@@ -212,6 +212,13 @@ unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
 
+void CCoinsViewCache::ForEachDirtyCoin(const std::function<void(const COutPoint&, const Coin&)>& f) const {
+    for (const auto& entry : cacheCoins) {
+        if ((entry.second.flags & CCoinsCacheEntry::DIRTY) && !entry.second.coin.IsSpent())
+            f(entry.first, entry.second.coin);
+    }
+}
+
 CAmount CCoinsViewCache::GetValueIn(const CTransaction& tx) const
 {
     if (tx.IsCoinBase())
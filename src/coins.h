@@ -278,6 +278,9 @@ public:
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
+    //! Call f on every unspent coin changed since the last flush, which the base view may not have yet
+    void ForEachDirtyCoin(const std::function<void(const COutPoint&, const Coin&)>& f) const;
+
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
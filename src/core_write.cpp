@@ -12,6 +12,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <univalue.h>
+#include <univalue_builder.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <nameclaim.h>
@@ -197,7 +198,7 @@ void ScriptPubKeyToUniv(const CScript& scriptPubKey,
             a.push_back(EncodeDestination(addr));
         }
         if (!a.empty()) {
-            out.pushKV("addresses", a);
+            PushKVMove(out, "addresses", std::move(a));
         }
     }
 }
@@ -213,6 +214,7 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry,
     entry.pushKV("locktime", (int64_t)tx.nLockTime);
 
     UniValue vin(UniValue::VARR);
+    UniValueReserve(vin, tx.vin.size());
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
         const CTxIn& txin = tx.vin[i];
         UniValue in(UniValue::VOBJ);
@@ -224,21 +226,22 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry,
             UniValue o(UniValue::VOBJ);
             o.pushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
             o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-            in.pushKV("scriptSig", o);
+            PushKVMove(in, "scriptSig", std::move(o));
             if (!tx.vin[i].scriptWitness.IsNull()) {
                 UniValue txinwitness(UniValue::VARR);
                 for (const auto& item : tx.vin[i].scriptWitness.stack) {
                     txinwitness.push_back(HexStr(item.begin(), item.end()));
                 }
-                in.pushKV("txinwitness", txinwitness);
+                PushKVMove(in, "txinwitness", std::move(txinwitness));
             }
         }
         in.pushKV("sequence", (int64_t)txin.nSequence);
-        vin.push_back(in);
+        PushBackMove(vin, std::move(in));
     }
-    entry.pushKV("vin", vin);
+    PushKVMove(entry, "vin", std::move(vin));
 
     UniValue vout(UniValue::VARR);
+    UniValueReserve(vout, tx.vout.size());
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         const CTxOut& txout = tx.vout[i];
 
@@ -249,10 +252,10 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry,
 
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToUniv(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
-        vout.push_back(out);
+        PushKVMove(out, "scriptPubKey", std::move(o));
+        PushBackMove(vout, std::move(out));
     }
-    entry.pushKV("vout", vout);
+    PushKVMove(entry, "vout", std::move(vout));
 
     if (!hashBlock.IsNull())
         entry.pushKV("blockhash", hashBlock.GetHex());
@@ -8,6 +8,7 @@
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
 #include <key_io.h>
+#include <rpc/cbor.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <sync.h>
@@ -67,7 +68,25 @@ static std::string strRPCUserColonPass;
 /* Stored RPC timer interface (for unregistration) */
 static std::unique_ptr<HTTPRPCTimerInterface> httpRPCTimerInterface;
 
-static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
+/** Send a reply as CBOR when the client asked for it, JSON otherwise */
+static void WriteRPCReply(HTTPRequest* req, int nStatus, const UniValue& reply, bool fCBOR, const UniValue& request = NullUniValue)
+{
+    if (fCBOR) {
+        req->WriteHeader("Content-Type", CBOR_CONTENT_TYPE);
+        req->WriteReply(nStatus, EncodeCBORReply(reply, request));
+    } else {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(nStatus, reply.write() + "\n");
+    }
+}
+
+static bool HeaderHasCBOR(HTTPRequest* req, const std::string& header)
+{
+    auto value = req->GetHeader(header);
+    return value.first && value.second.find(CBOR_CONTENT_TYPE) != std::string::npos;
+}
+
+static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id, bool fCBOR = false)
 {
     // Send error reply from json-rpc error object
     int nStatus = HTTP_INTERNAL_SERVER_ERROR;
@@ -78,10 +97,7 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     else if (code == RPC_METHOD_NOT_FOUND)
         nStatus = HTTP_NOT_FOUND;
 
-    std::string strReply = JSONRPCReply(NullUniValue, objError, id);
-
-    req->WriteHeader("Content-Type", "application/json");
-    req->WriteReply(nStatus, strReply);
+    WriteRPCReply(req, nStatus, JSONRPCReplyObj(NullUniValue, objError, id), fCBOR);
 }
 
 //This function checks username and password against -rpcauth
@@ -175,16 +191,20 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    // the same request model can come as CBOR, and the reply goes back that way too if asked for
+    const bool fCBORRequest = HeaderHasCBOR(req, "content-type");
+    const bool fCBORReply = fCBORRequest || HeaderHasCBOR(req, "accept");
+
     try {
         // Parse request
         UniValue valRequest;
-        if (!valRequest.read(req->ReadBody()))
+        if (fCBORRequest ? !DecodeCBOR(req->ReadBody(), valRequest) : !valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
+        UniValue reply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -192,21 +212,20 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            reply = JSONRPCReplyObj(result, NullUniValue, jreq.id);
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            reply = JSONRPCExecBatchObj(jreq, valRequest.get_array());
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        WriteRPCReply(req, HTTP_OK, reply, fCBORReply, valRequest);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        JSONErrorReply(req, objError, jreq.id, fCBORReply);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id, fCBORReply);
         return false;
     }
     return true;
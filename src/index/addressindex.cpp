@@ -0,0 +1,106 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <index/addressindex.h>
+#include <key_io.h>
+#include <util/system.h>
+#include <validation.h>
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+/**
+ * Access to the address index database (indexes/addressindex/)
+ *
+ * Every output with an address is a row keyed by its outpoint; spending it fills in the
+ * spending transaction and height. A funding event is a row at its height, a spending event
+ * is a row at its spent height, so both are covered by an index on the address and a height.
+ */
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+        : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "addressindex", n_cache_size, f_memory, f_wipe))
+{
+    (*m_db) << "CREATE TABLE IF NOT EXISTS address_history ("
+               "txID BLOB NOT NULL, "
+               "txN INTEGER NOT NULL, "
+               "address TEXT NOT NULL, "
+               "amount INTEGER NOT NULL, "
+               "height INTEGER NOT NULL, "
+               "spentTxID BLOB, "
+               "spentHeight INTEGER, "
+               "PRIMARY KEY(txID, txN))";
+
+    if (f_wipe)
+        (*m_db) << "DELETE FROM address_history";
+
+    (*m_db) << "CREATE INDEX IF NOT EXISTS address_history_address ON address_history (address, height)";
+    (*m_db) << "CREATE INDEX IF NOT EXISTS address_history_spent ON address_history (address, spentHeight) "
+               "WHERE spentHeight IS NOT NULL";
+    (*m_db) << "CREATE INDEX IF NOT EXISTS address_history_height ON address_history (height)";
+    (*m_db) << "CREATE INDEX IF NOT EXISTS address_history_spentHeight ON address_history (spentHeight)";
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // transaction is begin and commited in the caller of this method
+    auto spend = (*m_db) << "UPDATE address_history SET spentTxID = ?, spentHeight = ? "
+                            "WHERE txID = ? AND txN = ? AND spentTxID IS NULL";
+    auto insert = (*m_db) << "INSERT OR REPLACE INTO address_history(txID, txN, address, amount, height) "
+                             "VALUES(?,?,?,?,?)";
+    for (const auto& tx : block.vtx) {
+        const auto hash = tx->GetHash();
+        if (!tx->IsCoinBase()) {
+            for (const auto& txin : tx->vin) {
+                spend << hash << pindex->nHeight << txin.prevout.hash << txin.prevout.n;
+                spend++;
+            }
+        }
+
+        for (uint32_t i = 0; i < tx->vout.size(); ++i) {
+            auto address = EncodeScriptDestination(tx->vout[i].scriptPubKey);
+            if (address.empty())
+                continue;
+            insert << hash << i << address << tx->vout[i].nValue << pindex->nHeight;
+            insert++;
+        }
+    }
+    spend.used(true);
+    insert.used(true);
+    return true;
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    (*m_db) << "DELETE FROM address_history WHERE height > ?" << new_tip->nHeight;
+    (*m_db) << "UPDATE address_history SET spentTxID = NULL, spentHeight = NULL WHERE spentHeight > ?"
+            << new_tip->nHeight;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+void AddressIndex::FindAddressHistory(const std::string& address, int skip, int count,
+                                      std::vector<CAddressHistoryEntry>& entries) const
+{
+    // the order has to be total for pages to line up; within a block, funding comes before spending
+    auto query = (*m_db) << "SELECT txID, height, txID, txN, amount, 0 AS spent FROM address_history "
+                            "WHERE address = ? UNION ALL "
+                            "SELECT spentTxID, spentHeight, txID, txN, -amount, 1 FROM address_history "
+                            "WHERE address = ? AND spentHeight IS NOT NULL "
+                            "ORDER BY 2, 6, 1, 3, 4 LIMIT ? OFFSET ?"
+                         << address << address << count << skip;
+    entries.clear();
+    for (auto&& row : query) {
+        CAddressHistoryEntry entry;
+        row >> entry.txId >> entry.nHeight >> entry.outPoint.hash >> entry.outPoint.n >> entry.nDelta;
+        entries.push_back(std::move(entry));
+    }
+}
+
+void AddressIndex::GetAddressBalance(const std::string& address, int height, CAmount& balance, CAmount& received) const
+{
+    (*m_db) << "SELECT IFNULL(SUM(CASE WHEN spentHeight IS NULL OR spentHeight > ?1 THEN amount ELSE 0 END), 0), "
+               "IFNULL(SUM(amount), 0) FROM address_history WHERE address = ?2 AND height <= ?1"
+            << height << address >> std::tie(balance, received);
+}
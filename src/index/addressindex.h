@@ -0,0 +1,68 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <uint256.h>
+
+#include <string>
+#include <vector>
+
+/** An output paying to an address either being created (funding) or being spent. */
+struct CAddressHistoryEntry
+{
+    uint256 txId;         //!< the funding or the spending transaction
+    int nHeight;
+    COutPoint outPoint;   //!< the output paying to the address
+    CAmount nDelta;       //!< positive when funding, negative when spending
+};
+
+/**
+ * AddressIndex records every output paying to an address, along with the transaction and
+ * height it was spent at, so that everything that ever touched an address can be listed
+ * and its balance computed as of any height.
+ */
+class AddressIndex final : public BaseIndex
+{
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    virtual ~AddressIndex() override = default;
+
+    /// Look up a page of the funding and spending events of an address, oldest first.
+    ///
+    /// @param[in]   address  The encoded address to look up.
+    /// @param[in]   skip     Number of events to skip.
+    /// @param[in]   count    Maximum number of events to return.
+    /// @param[out]  entries  The events, ordered by height.
+    void FindAddressHistory(const std::string& address, int skip, int count, std::vector<CAddressHistoryEntry>& entries) const;
+
+    /// Sum the outputs paying to an address as of the end of a block.
+    ///
+    /// @param[in]   address   The encoded address to look up.
+    /// @param[in]   height    The height to compute the balance at.
+    /// @param[out]  balance   Unspent at that height.
+    /// @param[out]  received  Received up to and including that height.
+    void GetAddressBalance(const std::string& address, int height, CAmount& balance, CAmount& received) const;
+};
+
+/// The global address index, used in getaddresshistory and getaddressbalance. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -0,0 +1,142 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <chainparams.h>
+#include <index/claimindex.h>
+#include <nameclaim.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+
+std::unique_ptr<ClaimIndex> g_claimindex;
+
+/**
+ * Access to the claim index database (indexes/claimindex/)
+ *
+ * Every claim, update and support output is a row keyed by its outpoint; spending it fills in
+ * the spending transaction and height. Rows are looked up by claimID, and rewound by height.
+ */
+
+ClaimIndex::ClaimIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+        : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "claimindex", n_cache_size, f_memory, f_wipe))
+{
+    (*m_db) << "CREATE TABLE IF NOT EXISTS claim_history ("
+               "txID BLOB NOT NULL, "
+               "txN INTEGER NOT NULL, "
+               "claimID BLOB NOT NULL, "
+               "op INTEGER NOT NULL, "
+               "name BLOB NOT NULL, "
+               "amount INTEGER NOT NULL, "
+               "height INTEGER NOT NULL, "
+               "spentTxID BLOB, "
+               "spentHeight INTEGER, "
+               "PRIMARY KEY(txID, txN))";
+
+    if (f_wipe)
+        (*m_db) << "DELETE FROM claim_history";
+
+    (*m_db) << "CREATE INDEX IF NOT EXISTS claim_history_claimID ON claim_history (claimID)";
+    (*m_db) << "CREATE INDEX IF NOT EXISTS claim_history_height ON claim_history (height)";
+    (*m_db) << "CREATE INDEX IF NOT EXISTS claim_history_spentHeight ON claim_history (spentHeight)";
+}
+
+bool ClaimIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    const auto& consensus = Params().GetConsensus();
+    const bool allowSupportMetadata = pindex->nHeight >= consensus.nAllClaimsInMerkleForkHeight;
+    const bool normalize = pindex->nHeight > consensus.nNormalizedNameForkHeight;
+    auto normalized = [normalize](const std::string& name) {
+        return normalize ? CClaimTrieCacheNormalizationFork::normalizedName(name) : name;
+    };
+
+    struct SpentClaim {
+        uint160 claimId;
+        std::string name;
+    };
+
+    // transaction is begin and commited in the caller of this method
+    auto spent = (*m_db) << "SELECT claimID, name FROM claim_history "
+                            "WHERE txID = ? AND txN = ? AND op != ? AND spentTxID IS NULL";
+    auto spend = (*m_db) << "UPDATE claim_history SET spentTxID = ?, spentHeight = ? "
+                            "WHERE txID = ? AND txN = ? AND spentTxID IS NULL";
+    auto insert = (*m_db) << "INSERT OR REPLACE INTO claim_history(txID, txN, claimID, op, name, amount, height) "
+                             "VALUES(?,?,?,?,?,?,?)";
+    for (const auto& tx : block.vtx) {
+        const auto hash = tx->GetHash();
+        std::vector<SpentClaim> spentClaims;
+        if (!tx->IsCoinBase()) {
+            for (const auto& txin : tx->vin) {
+                for (auto&& row : spent << txin.prevout.hash << txin.prevout.n << OP_SUPPORT_CLAIM) {
+                    SpentClaim claim;
+                    row >> claim.claimId >> claim.name;
+                    spentClaims.push_back(std::move(claim));
+                }
+                spent++;
+                spend << hash << pindex->nHeight << txin.prevout.hash << txin.prevout.n;
+                spend++;
+            }
+        }
+
+        for (uint32_t i = 0; i < tx->vout.size(); ++i) {
+            int op;
+            std::vector<std::vector<unsigned char>> vvchParams;
+            if (!DecodeClaimScript(tx->vout[i].scriptPubKey, op, vvchParams, allowSupportMetadata))
+                continue;
+            std::string name(vvchParams[0].begin(), vvchParams[0].end());
+            auto claimId = op == OP_CLAIM_NAME ? ClaimIdHash(hash, i) : uint160(vvchParams[1]);
+            if (op == OP_UPDATE_CLAIM) {
+                // as in the trie, an update has to spend the claim it updates, and each spent claim updates once
+                auto it = std::find_if(spentClaims.begin(), spentClaims.end(), [&](const SpentClaim& claim) {
+                    return claim.claimId == claimId && normalized(claim.name) == normalized(name);
+                });
+                if (it == spentClaims.end())
+                    continue;
+                spentClaims.erase(it);
+            }
+            insert << hash << i << claimId << op << name << tx->vout[i].nValue << pindex->nHeight;
+            insert++;
+        }
+    }
+    spent.used(true);
+    spend.used(true);
+    insert.used(true);
+    return true;
+}
+
+bool ClaimIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    (*m_db) << "DELETE FROM claim_history WHERE height > ?" << new_tip->nHeight;
+    (*m_db) << "UPDATE claim_history SET spentTxID = NULL, spentHeight = NULL WHERE spentHeight > ?"
+            << new_tip->nHeight;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+bool ClaimIndex::FindClaimHistory(const uint160& claim_id, std::vector<CClaimHistoryEntry>& entries) const
+{
+    // an output of the claim spent by a transaction with another one was updated, not abandoned
+    auto query = (*m_db) << "SELECT h.txID, h.txN, h.op, h.name, h.amount, h.height, h.spentTxID, h.spentHeight, "
+                            "h.op != ? AND EXISTS (SELECT 1 FROM claim_history u WHERE u.txID = h.spentTxID "
+                            "AND u.claimID = h.claimID AND u.op = ?) "
+                            "FROM claim_history h WHERE h.claimID = ? ORDER BY h.height, h.rowid"
+                         << OP_SUPPORT_CLAIM << OP_UPDATE_CLAIM << claim_id;
+    entries.clear();
+    for (auto&& row : query) {
+        CClaimHistoryEntry entry;
+        std::unique_ptr<uint256> spentTxId;
+        std::unique_ptr<int> spentHeight;
+        int updated;
+        row >> entry.outPoint.hash >> entry.outPoint.n >> entry.op >> entry.name >> entry.nAmount
+            >> entry.nHeight >> spentTxId >> spentHeight >> updated;
+        entry.fUpdated = updated != 0;
+        if (spentTxId)
+            entry.spentTxId = *spentTxId;
+        entry.nSpentHeight = spentHeight ? *spentHeight : -1;
+        entries.push_back(std::move(entry));
+    }
+    return !entries.empty();
+}
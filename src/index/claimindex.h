@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#ifndef BITCOIN_INDEX_CLAIMINDEX_H
+#define BITCOIN_INDEX_CLAIMINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <uint256.h>
+
+#include <string>
+#include <vector>
+
+/** One output in the life of a claim: the claim itself, one of its updates, or a support for it. */
+struct CClaimHistoryEntry
+{
+    COutPoint outPoint;
+    int op;               //!< OP_CLAIM_NAME, OP_UPDATE_CLAIM or OP_SUPPORT_CLAIM
+    std::string name;     //!< as written in the script, not normalized
+    CAmount nAmount;
+    int nHeight;
+    uint256 spentTxId;    //!< null while unspent
+    int nSpentHeight;     //!< -1 while unspent
+    bool fUpdated;        //!< spent by a transaction updating the claim, as opposed to abandoning it
+};
+
+/**
+ * ClaimIndex records every claim, update and support output by the claimID it belongs to,
+ * along with the transaction and height it was spent at, so that the whole history of
+ * a claim can be looked up long after the claimtrie has moved on from it.
+ */
+class ClaimIndex final : public BaseIndex
+{
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "claimindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit ClaimIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    virtual ~ClaimIndex() override = default;
+
+    /// Look up every output of a claim and its supports, oldest first.
+    ///
+    /// @param[in]   claim_id  The claim to look up.
+    /// @param[out]  entries   Its claim, updates and supports.
+    /// @return  true if the claim is known to the index, false otherwise
+    bool FindClaimHistory(const uint160& claim_id, std::vector<CClaimHistoryEntry>& entries) const;
+};
+
+/// The global claim history index, used in getclaimhistory. May be null.
+extern std::unique_ptr<ClaimIndex> g_claimindex;
+
+#endif // BITCOIN_INDEX_CLAIMINDEX_H
@@ -0,0 +1,70 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <index/spentindex.h>
+#include <util/system.h>
+#include <validation.h>
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/**
+ * Access to the spent index database (indexes/spentindex/)
+ *
+ * One row per spent outpoint, keyed by it, and rewound by the height it was spent at.
+ */
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+        : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "spentindex", n_cache_size, f_memory, f_wipe))
+{
+    (*m_db) << "CREATE TABLE IF NOT EXISTS spent ("
+               "txID BLOB NOT NULL, "
+               "txN INTEGER NOT NULL, "
+               "spentTxID BLOB NOT NULL, "
+               "spentN INTEGER NOT NULL, "
+               "height INTEGER NOT NULL, "
+               "PRIMARY KEY(txID, txN)) WITHOUT ROWID";
+
+    if (f_wipe)
+        (*m_db) << "DELETE FROM spent";
+
+    (*m_db) << "CREATE INDEX IF NOT EXISTS spent_height ON spent (height)";
+}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // transaction is begin and commited in the caller of this method
+    auto insert = (*m_db) << "INSERT OR REPLACE INTO spent VALUES(?,?,?,?,?)";
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        const auto hash = tx->GetHash();
+        for (uint32_t i = 0; i < tx->vin.size(); ++i) {
+            const auto& prevout = tx->vin[i].prevout;
+            insert << prevout.hash << prevout.n << hash << i << pindex->nHeight;
+            insert++;
+        }
+    }
+    insert.used(true);
+    return true;
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    (*m_db) << "DELETE FROM spent WHERE height > ?" << new_tip->nHeight;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+bool SpentIndex::FindSpend(const COutPoint& out, CSpentIndexValue& value) const
+{
+    auto query = (*m_db) << "SELECT spentTxID, spentN, height FROM spent WHERE txID = ? AND txN = ?"
+                         << out.hash << out.n;
+    auto it = query.begin();
+    if (it == query.end())
+        return false;
+    *it >> value.txId >> value.nIn >> value.nHeight;
+    return true;
+}
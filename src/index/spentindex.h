@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <serialize.h>
+#include <uint256.h>
+
+/** Where an output was spent: the input of a transaction in the active chain. */
+struct CSpentIndexValue
+{
+    uint256 txId;
+    uint32_t nIn = 0;
+    int nHeight = -1;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txId);
+        READWRITE(nIn);
+        READWRITE(nHeight);
+    }
+};
+
+/**
+ * SpentIndex maps every outpoint spent in the active chain to the transaction input
+ * spending it, so that following a coin or a claim forward is a single lookup.
+ */
+class SpentIndex final : public BaseIndex
+{
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    virtual ~SpentIndex() override = default;
+
+    /// Look up the input spending an outpoint.
+    ///
+    /// @param[in]   out    The outpoint to look up.
+    /// @param[out]  value  The spending transaction, input index and height.
+    /// @return  true if the outpoint is spent in the active chain, false otherwise
+    bool FindSpend(const COutPoint& out, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used in getspentinfo and the /rest/spent endpoint. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
@@ -23,7 +23,10 @@
 #include <fs.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/claimindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
@@ -38,6 +41,7 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <rpc/blockchain.h>
+#include <rpc/cache.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -171,6 +175,12 @@ void Interrupt()
         g_connman->Interrupt();
     if (g_txindex)
         g_txindex->Interrupt();
+    if (g_claimindex)
+        g_claimindex->Interrupt();
+    if (g_addressindex)
+        g_addressindex->Interrupt();
+    if (g_spentindex)
+        g_spentindex->Interrupt();
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
@@ -251,6 +261,18 @@ void Shutdown(InitInterfaces& interfaces)
     if (g_txindex) {
         g_txindex->Stop();
         g_txindex.reset();
+    }
+    if (g_claimindex) {
+        g_claimindex->Stop();
+        g_claimindex.reset();
+    }
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
+    if (g_spentindex) {
+        g_spentindex->Stop();
+        g_spentindex.reset();
     }ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -265,6 +287,8 @@ void Shutdown(InitInterfaces& interfaces)
         if (g_chainstate && g_chainstate->CanFlushToDisk()) {
             g_chainstate->ForceFlushStateToDisk(true);
             g_chainstate->ResetCoinsViews();
+            if (gArgs.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCKINDEX_SNAPSHOT))
+                WriteBlockIndexSnapshot();
         }
         pblocktree.reset();
     }
@@ -365,6 +389,7 @@ void SetupServerArgs()
 
     gArgs.AddArg("-version", "Print version and exit", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
+    gArgs.AddArg("-addressindex", strprintf("Maintain an index of every output by the address it pays to and where it was spent, used by the getaddresshistory and getaddressbalance rpc calls (default: %u)", DEFAULT_ADDRESSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -372,12 +397,25 @@ void SetupServerArgs()
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
+    gArgs.AddArg("-blockindexmmap=<n>", strprintf("Memory map up to <n> MiB of the block index database (default: %d)", nDefaultDbMmap), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexsnapshot", strprintf("Write the block index to a flat file at shutdown, which is read instead of the database on the next startup unless it has changed since (default: %u)", DEFAULT_BLOCKINDEX_SNAPSHOT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexpagesize=<n>", "Convert the block index database to <n> byte pages (512 to 65536, a power of 2) on startup; it is copied in the process, so needs as much free disk space", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Transactions from the wallet, RPC and relay whitelisted inbound peers are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimindex", strprintf("Maintain an index of every claim, update and support by claimId, used by the getclaimhistory rpc call (default: %u)", DEFAULT_CLAIMINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimtriearchive", strprintf("Keep spent claims and supports so that claim RPCs given a block hash answer from the database at any depth instead of rolling back at most 500 blocks; history is complete from the height this is first enabled at (use -reindex for all of it), and disabling it drops it (default: %u)", DEFAULT_CLAIMTRIE_ARCHIVE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimtriemmap=<n>", strprintf("Memory map up to <n> MiB of the claimtrie database (default: %d)", nDefaultDbMmap), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimtriepagesize=<n>", "Convert the claimtrie database to <n> byte pages (512 to 65536, a power of 2) on startup; it is copied in the process, so needs as much free disk space", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-claimtrieprefetch=<n>", strprintf("Read claimtrie rows that activate or expire within the next <n> blocks into the page cache from a background thread (0 = disabled, default: %d)", DEFAULT_CLAIMTRIE_PREFETCH_DEPTH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-cmpctblockprefillclaims", strprintf("Send claim transactions missing from our mempool in full when announcing compact blocks, up to %u bytes per block (default: %u)", MAX_CMPCTBLOCK_PREFILL_CLAIMS_SIZE, DEFAULT_CMPCTBLOCK_PREFILL_CLAIMS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinsdbmmap=<n>", strprintf("Memory map up to <n> MiB of the chain state database (default: %d)", nDefaultDbMmap), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinsdbpagesize=<n>", "Convert the chain state database to <n> byte pages (512 to 65536, a power of 2) on startup; it is copied in the process, so needs as much free disk space", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-compacttakeovers=<n>", strprintf("Move takeovers superseded more than <n> blocks ago out of the claimtrie's takeover table into an archive table (0 = disabled, minimum: %u, default: %d)", MIN_BLOCKS_TO_KEEP, DEFAULT_TAKEOVER_HISTORY_WINDOW), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbwalbudget=<n>", strprintf("Let the write-ahead log of each database grow to <n> MiB before the writing thread truncates it, with checkpoints running in the background until then; 0 checkpoints on the writing thread only (default: %d)", nDefaultDbWalBudget), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -396,6 +434,7 @@ void SetupServerArgs()
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-spentindex", strprintf("Maintain an index of every spent output by the input spending it, used by the getspentinfo rpc call and the /rest/spent endpoint (default: %u)", DEFAULT_SPENTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
@@ -431,6 +470,7 @@ void SetupServerArgs()
     gArgs.AddArg("-port=<port>", strprintf("Listen for connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort(), regtestChainParams->GetDefaultPort()), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-recentblockcache=<n>", strprintf("Keep recently connected blocks serialized in up to <n> MiB of memory, to serve them to peers without reading them from disk, 0 to disable (default: %u)", DEFAULT_RECENT_BLOCK_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
@@ -537,6 +577,8 @@ void SetupServerArgs()
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpccachedepth=<n>", strprintf("Only cache replies about blocks at least <n> blocks below the tip (default: %d)", DEFAULT_RPC_CACHE_DEPTH), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpccachesize=<n>", strprintf("Cache up to <n> MiB of replies to getblock, getblockheader, getchangesinblock and claim queries addressed to blocks deep below the tip (default: %d, 0 to disable)", DEFAULT_RPC_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpccookiefile=<loc>", "Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpassword=<pw>", "Password for JSON-RPC connections", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
@@ -765,6 +807,8 @@ static bool AppInitServers()
 {
     RPCServer::OnStarted(&OnRPCStarted);
     RPCServer::OnStopped(&OnRPCStopped);
+    g_rpc_result_cache.Configure(std::max<int64_t>(gArgs.GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE), 0) << 20,
+                                 gArgs.GetArg("-rpccachedepth", DEFAULT_RPC_CACHE_DEPTH));
     if (!InitHTTPServer())
         return false;
     StartRPC();
@@ -975,6 +1019,12 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex.").translated);
+        if (gArgs.GetBoolArg("-claimindex", DEFAULT_CLAIMINDEX))
+            return InitError(_("Prune mode is incompatible with -claimindex.").translated);
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex.").translated);
+        if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))
+            return InitError(_("Prune mode is incompatible with -spentindex.").translated);
         if (!g_enabled_filter_types.empty()) {
             return InitError(_("Prune mode is incompatible with -blockfilterindex.").translated);
         }
@@ -1165,6 +1215,17 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-rpcserialversion", DEFAULT_RPC_SERIALIZE_VERSION) > 1)
         return InitError("unknown rpcserialversion requested.");
 
+    if (gArgs.GetArg("-dbwalbudget", nDefaultDbWalBudget) < 0)
+        return InitError("-dbwalbudget cannot be configured with a negative value.");
+    for (const char* arg : {"-claimtriemmap", "-coinsdbmmap", "-blockindexmmap"})
+        if (gArgs.GetArg(arg, nDefaultDbMmap) < 0)
+            return InitError(strprintf("%s cannot be configured with a negative value.", arg));
+    for (const char* arg : {"-claimtriepagesize", "-coinsdbpagesize", "-blockindexpagesize"}) {
+        int64_t pageSize = gArgs.GetArg(arg, nDefaultDbPageSize);
+        if (pageSize != 0 && (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)) != 0))
+            return InitError(strprintf("%s must be a power of 2 from 512 to 65536.", arg));
+    }
+
     nMaxTipAge = gArgs.GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     return true;
@@ -1452,6 +1513,9 @@ bool AppInitMain(InitInterfaces& interfaces)
     int64_t nClaimtrieCache = ::Claimtrie().cache();
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 4, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? int64_t(1 << 24) : 0);
+    int64_t nClaimIndexCache = std::min(nTotalCache / 4, gArgs.GetBoolArg("-claimindex", DEFAULT_CLAIMINDEX) ? int64_t(1 << 24) : 0);
+    int64_t nAddressIndexCache = std::min(nTotalCache / 4, gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? int64_t(1 << 24) : 0);
+    int64_t nSpentIndexCache = std::min(nTotalCache / 4, gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? int64_t(1 << 24) : 0);
     int64_t filter_index_cache = 0;
     if (!g_enabled_filter_types.empty()) {
         size_t n_indexes = g_enabled_filter_types.size();
@@ -1471,6 +1535,12 @@ bool AppInitMain(InitInterfaces& interfaces)
     LogPrintf("* Using %.1fMiB for claimtrie database cache\n", nClaimtrieCache * (1.0 / 1024 / 1024));
     if (nTxIndexCache)
         LogPrintf("* Using %.1fMiB for txindex database cache\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    if (nClaimIndexCache)
+        LogPrintf("* Using %.1fMiB for claimindex database cache\n", nClaimIndexCache * (1.0 / 1024 / 1024));
+    if (nAddressIndexCache)
+        LogPrintf("* Using %.1fMiB for addressindex database cache\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    if (nSpentIndexCache)
+        LogPrintf("* Using %.1fMiB for spentindex database cache\n", nSpentIndexCache * (1.0 / 1024 / 1024));
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
@@ -1688,6 +1758,21 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_txindex->Start();
     }
 
+    if (gArgs.GetBoolArg("-claimindex", DEFAULT_CLAIMINDEX)) {
+        g_claimindex = MakeUnique<ClaimIndex>(nClaimIndexCache, false, fReindex);
+        g_claimindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex = MakeUnique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        g_addressindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spentindex = MakeUnique<SpentIndex>(nSpentIndexCache, false, fReindex);
+        g_spentindex->Start();
+    }
+
     for (const auto& filter_type : g_enabled_filter_types) {
         InitBlockFilterIndex(filter_type, filter_index_cache, false, fReindex);
         GetBlockFilterIndex(filter_type)->Start();
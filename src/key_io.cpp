@@ -213,6 +213,14 @@ std::string EncodeDestination(const CTxDestination& dest)
     return boost::apply_visitor(DestinationEncoder(Params()), dest);
 }
 
+std::string EncodeScriptDestination(const CScript& script)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(script, dest))
+        return {};
+    return EncodeDestination(dest);
+}
+
 CTxDestination DecodeDestination(const std::string& str)
 {
     return DecodeDestination(str, Params());
@@ -29,6 +29,7 @@
 #include <util/strencodings.h>
 #include <util/validation.h>
 
+#include <algorithm>
 #include <memory>
 #include <typeinfo>
 
@@ -1095,10 +1096,77 @@ static bool BlockRequestAllowed(const CBlockIndex* pindex, const Consensus::Para
         (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensusParams) < STALE_RELAY_AGE_LIMIT);
 }
 
+// Blocks connected lately, kept serialized for getdata
+static RecentBlockCache recent_blocks(DEFAULT_RECENT_BLOCK_CACHE_SIZE << 20);
+
+void RecentBlockCache::Evict(size_t max_usage)
+{
+    while (m_usage > max_usage) {
+        auto& entry = m_entries.back();
+        m_usage -= entry.usage;
+        m_index.erase(entry.hash);
+        m_entries.pop_back();
+    }
+}
+
+void RecentBlockCache::SetMaxUsage(size_t max_usage)
+{
+    LOCK(m_mutex);
+    m_max_usage = max_usage;
+    Evict(m_max_usage);
+}
+
+void RecentBlockCache::Add(const CBlock& block)
+{
+    const uint256 hash = block.GetHash();
+    {
+        LOCK(m_mutex);
+        if (m_max_usage == 0 || m_index.count(hash))
+            return;
+    }
+
+    // serialize outside the lock, as getdata requests wait on it
+    auto witness = std::make_shared<std::vector<uint8_t>>();
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, *witness, 0, block);
+    std::shared_ptr<const std::vector<uint8_t>> no_witness = witness;
+    size_t usage = witness->size();
+    if (std::any_of(block.vtx.begin(), block.vtx.end(), [](const CTransactionRef& tx) { return tx->HasWitness(); })) {
+        auto stripped = std::make_shared<std::vector<uint8_t>>();
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS, *stripped, 0, block);
+        usage += stripped->size();
+        no_witness = std::move(stripped);
+    }
+
+    LOCK(m_mutex);
+    if (usage > m_max_usage || m_index.count(hash))
+        return;
+    Evict(m_max_usage - usage);
+    m_entries.push_front({hash, std::move(witness), std::move(no_witness), usage});
+    m_index.emplace(hash, m_entries.begin());
+    m_usage += usage;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> RecentBlockCache::Get(const uint256& hash, bool witness)
+{
+    LOCK(m_mutex);
+    auto it = m_index.find(hash);
+    if (it == m_index.end())
+        return nullptr;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return witness ? it->second->witness : it->second->no_witness;
+}
+
+size_t RecentBlockCache::Usage() const
+{
+    LOCK(m_mutex);
+    return m_usage;
+}
+
 PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CScheduler &scheduler, bool enable_bip61)
     : connman(connmanIn), m_banman(banman), m_stale_tip_check_time(0), m_enable_bip61(enable_bip61) {
     // Initialize global variables that cannot be constructed at startup.
     recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    recent_blocks.SetMaxUsage(std::max<int64_t>(gArgs.GetArg("-recentblockcache", DEFAULT_RECENT_BLOCK_CACHE_SIZE), 0) << 20);
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
     // Stale tip checking and peer eviction are on two different timers, but we
@@ -1111,9 +1179,13 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CS
 
 /**
  * Evict orphan txn pool entries (EraseOrphanTx) based on a newly connected
- * block. Also save the time of the last tip update.
+ * block. Also save the time of the last tip update, and keep the block
+ * serialized for peers that will ask for it.
  */
 void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted) {
+    if (!::ChainstateActive().IsInitialBlockDownload())
+        recent_blocks.Add(*pblock);
+
     LOCK(g_cs_orphans);
 
     std::vector<uint256> vOrphanErase;
@@ -1152,12 +1224,36 @@ static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_bloc
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
+/**
+ * Pick claim transactions that were not in our mempool to send in full with
+ * the compact block; if we never saw them, peers likely did not either and
+ * would otherwise need a getblocktxn round trip.
+ */
+static std::vector<uint16_t> ClaimTxnToPrefill(const CBlock& block)
+{
+    std::vector<uint16_t> prefill;
+    if (!gArgs.GetBoolArg("-cmpctblockprefillclaims", DEFAULT_CMPCTBLOCK_PREFILL_CLAIMS))
+        return prefill;
+
+    size_t nSize = 0;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!HasClaimOutputs(tx) || mempool.exists(tx.GetHash()))
+            continue;
+        nSize += tx.GetTotalSize();
+        if (nSize > MAX_CMPCTBLOCK_PREFILL_CLAIMS_SIZE)
+            break;
+        prefill.push_back(i);
+    }
+    return prefill;
+}
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
  */
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
-    std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
+    std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true, ClaimTxnToPrefill(*pblock));
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 
     LOCK(cs_main);
@@ -1427,7 +1523,12 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
     {
         std::shared_ptr<const CBlock> pblock;
-        if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
+        std::shared_ptr<const std::vector<uint8_t>> cached_block_data;
+        if ((inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) &&
+                (cached_block_data = recent_blocks.Get(pindex->GetBlockHash(), inv.type == MSG_WITNESS_BLOCK))) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(*cached_block_data)));
+            // Don't set pblock as we've sent the block
+        } else if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
         } else if (inv.type == MSG_WITNESS_BLOCK) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
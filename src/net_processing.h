@@ -11,16 +11,59 @@
 #include <consensus/params.h>
 #include <sync.h>
 
+#include <list>
+#include <unordered_map>
+
 extern CCriticalSection cs_main;
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default for -cmpctblockprefillclaims */
+static const bool DEFAULT_CMPCTBLOCK_PREFILL_CLAIMS = false;
+/** Maximum serialized size of claim transactions prefilled into an announced compact block */
+static const unsigned int MAX_CMPCTBLOCK_PREFILL_CLAIMS_SIZE = 20000;
+/** Default for -recentblockcache, in MiB */
+static const unsigned int DEFAULT_RECENT_BLOCK_CACHE_SIZE = 32;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61{false};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 
+/**
+ * The most recently connected blocks, serialized for the network with and without witnesses,
+ * so that serving them to peers catching up with us takes neither a disk read nor a
+ * serialization. Bounded by the memory the serialized blocks take, evicting the least
+ * recently used first.
+ */
+class RecentBlockCache
+{
+    struct Entry {
+        uint256 hash;
+        std::shared_ptr<const std::vector<uint8_t>> witness;
+        std::shared_ptr<const std::vector<uint8_t>> no_witness; //!< shares witness for blocks without any
+        size_t usage;
+    };
+
+    mutable Mutex m_mutex;
+    std::list<Entry> m_entries GUARDED_BY(m_mutex); //!< most recently used first
+    std::unordered_map<uint256, std::list<Entry>::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex) = 0;
+    size_t m_max_usage GUARDED_BY(m_mutex);
+
+    void Evict(size_t max_usage) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    explicit RecentBlockCache(size_t max_usage) : m_max_usage(max_usage) {}
+
+    /** Limit the serialized blocks to max_usage bytes, 0 turning the cache off */
+    void SetMaxUsage(size_t max_usage);
+    void Add(const CBlock& block);
+    /** The serialized block, or nullptr if it isn't cached */
+    std::shared_ptr<const std::vector<uint8_t>> Get(const uint256& hash, bool witness);
+    size_t Usage() const;
+};
+
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
     CConnman* const connman;
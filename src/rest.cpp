@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <httpserver.h>
 #include <primitives/block.h>
@@ -634,6 +635,60 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+static bool rest_spent(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    // /rest/spent/<txid>-<n>
+    std::vector<std::string> parts;
+    boost::split(parts, param, boost::is_any_of("-"));
+    int32_t n;
+    if (parts.size() != 2 || !IsHex(parts[0]) || parts[0].size() != 64 || !ParseInt32(parts[1], &n) || n < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid outpoint: " + SanitizeString(param));
+    const COutPoint out(uint256S(parts[0]), n);
+
+    if (!g_spentindex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Spent index is not enabled");
+    if (!g_spentindex->BlockUntilSyncedToCurrentChain())
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Spent outputs are still in the process of being indexed");
+
+    CSpentIndexValue value;
+    if (!g_spentindex->FindSpend(out, value))
+        return RESTERR(req, HTTP_NOT_FOUND, out.ToString() + " not spent");
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        CDataStream ssSpent(SER_NETWORK, PROTOCOL_VERSION);
+        ssSpent << value;
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ssSpent.str());
+        return true;
+    }
+    case RetFormat::HEX: {
+        CDataStream ssSpent(SER_NETWORK, PROTOCOL_VERSION);
+        ssSpent << value;
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ssSpent.begin(), ssSpent.end()) + "\n");
+        return true;
+    }
+    case RetFormat::JSON: {
+        UniValue objSpent(UniValue::VOBJ);
+        objSpent.pushKV("txid", value.txId.GetHex());
+        objSpent.pushKV("vin", int(value.nIn));
+        objSpent.pushKV("height", value.nHeight);
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, objSpent.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -647,6 +702,7 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/spent/", rest_spent},
 };
 
 void StartREST()
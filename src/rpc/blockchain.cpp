@@ -14,11 +14,15 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <key_io.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/cache.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
@@ -27,6 +31,7 @@
 #include <txdb.h>
 #include <txmempool.h>
 #include <undo.h>
+#include <univalue_builder.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/validation.h>
@@ -139,18 +144,19 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
     result.pushKV("nameclaimroot", block.hashClaimTrie.GetHex());
     UniValue txs(UniValue::VARR);
+    UniValueReserve(txs, block.vtx.size());
     for(const auto& tx : block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
+            PushBackMove(txs, std::move(objTx));
         }
         else
             txs.push_back(tx->GetHash().GetHex());
     }
-    result.pushKV("tx", txs);
+    PushKVMove(result, "tx", std::move(txs));
     result.pushKV("time", block.GetBlockTime());
     result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
     result.pushKV("nonce", (uint64_t)block.nNonce);
@@ -471,6 +477,7 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
     if (verbose) {
         LOCK(pool.cs);
         UniValue o(UniValue::VOBJ);
+        UniValueReserve(o, pool.mapTx.size());
         for (const CTxMemPoolEntry& e : pool.mapTx) {
             const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
@@ -478,7 +485,7 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::__pushKV is used instead which currently is O(1).
-            o.__pushKV(hash.ToString(), info);
+            PushKVMoveUnique(o, hash.ToString(), std::move(info));
         }
         return o;
     } else {
@@ -486,6 +493,7 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
         pool.queryHashes(vtxid);
 
         UniValue a(UniValue::VARR);
+        UniValueReserve(a, vtxid.size());
         for (const uint256& hash : vtxid)
             a.push_back(hash.ToString());
 
@@ -587,7 +595,8 @@ static UniValue getmempoolancestors(const JSONRPCRequest& request)
             const uint256& _hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             entryToJSON(::mempool, info, e);
-            o.pushKV(_hash.ToString(), info);
+            // unique by construction, so skip pushKV's O(N) search for an existing key
+            PushKVMoveUnique(o, _hash.ToString(), std::move(info));
         }
         return o;
     }
@@ -654,7 +663,8 @@ static UniValue getmempooldescendants(const JSONRPCRequest& request)
             const uint256& _hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             entryToJSON(::mempool, info, e);
-            o.pushKV(_hash.ToString(), info);
+            // unique by construction, so skip pushKV's O(N) search for an existing key
+            PushKVMoveUnique(o, _hash.ToString(), std::move(info));
         }
         return o;
     }
@@ -1487,6 +1497,7 @@ static UniValue preciousblock(const JSONRPCRequest& request)
     CValidationState state;
     PreciousBlock(state, Params(), pblockindex);
 
+    g_rpc_result_cache.Clear();
     if (!state.IsValid()) {
         throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
     }
@@ -1525,6 +1536,8 @@ static UniValue invalidateblock(const JSONRPCRequest& request)
         ActivateBestChain(state, Params());
     }
 
+    // the active chain may have changed below the depth of the cached replies
+    g_rpc_result_cache.Clear();
     if (!state.IsValid()) {
         throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
     }
@@ -1562,6 +1575,7 @@ static UniValue reconsiderblock(const JSONRPCRequest& request)
     CValidationState state;
     ActivateBestChain(state, Params());
 
+    g_rpc_result_cache.Clear();
     if (!state.IsValid()) {
         throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
     }
@@ -2265,6 +2279,172 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
     return ret;
 }
 
+static std::string ParseAddress(const UniValue& param)
+{
+    // re-encode so that every spelling of an address finds the same rows
+    auto dest = DecodeDestination(param.get_str());
+    if (!IsValidDestination(dest))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + param.get_str());
+    return EncodeDestination(dest);
+}
+
+static UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddresshistory",
+                "\nReturns the transactions that funded or spent outputs paying to an address, oldest first, a page at a time.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address to look up"},
+                    {"skip", RPCArg::Type::NUM, /* default */ "0", "The number of events to skip"},
+                    {"count", RPCArg::Type::NUM, /* default */ "100", "The maximum number of events to return (at most 1000)"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",        (string) The transaction funding or spending the output\n"
+            "    \"height\" : n,           (numeric) The height of the block it is in\n"
+            "    \"category\" : \"receive|spend\", (string) Whether the output was created or spent\n"
+            "    \"outputtxid\" : \"hash\",  (string) The transaction of the output paying to the address\n"
+            "    \"vout\" : n,             (numeric) The index of the output\n"
+            "    \"amount\" : x.xxx,       (numeric) The change in balance, in " + CURRENCY_UNIT + "\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\" 100 100")
+            + HelpExampleRpc("getaddresshistory", "\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\", 100, 100")
+                },
+            }.Check(request);
+
+    if (!g_addressindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled; start with -addressindex");
+
+    auto address = ParseAddress(request.params[0]);
+    int skip = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    int count = request.params[2].isNull() ? 100 : request.params[2].get_int();
+    if (skip < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "skip should not be a negative value");
+    if (count < 1 || count > 1000)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count should be between 1 and 1000");
+
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Addresses are still in the process of being indexed.");
+
+    std::vector<CAddressHistoryEntry> entries;
+    g_addressindex->FindAddressHistory(address, skip, count, entries);
+
+    UniValue ret(UniValue::VARR);
+    for (auto& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.txId.GetHex());
+        obj.pushKV("height", entry.nHeight);
+        obj.pushKV("category", entry.nDelta < 0 ? "spend" : "receive");
+        obj.pushKV("outputtxid", entry.outPoint.hash.GetHex());
+        obj.pushKV("vout", int(entry.outPoint.n));
+        obj.pushKV("amount", ValueFromAmount(entry.nDelta));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddressbalance",
+                "\nReturns the balance of an address as of the end of a block.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address to look up"},
+                    {"height", RPCArg::Type::NUM, /* default */ "the tip", "The height to compute the balance at"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"height\" : n,          (numeric) The height the balance is computed at\n"
+            "  \"balance\" : x.xxx,     (numeric) The sum of the outputs unspent at that height, in " + CURRENCY_UNIT + "\n"
+            "  \"received\" : x.xxx,    (numeric) The sum of all outputs received up to that height, in " + CURRENCY_UNIT + "\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\" 1000")
+            + HelpExampleRpc("getaddressbalance", "\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\", 1000")
+                },
+            }.Check(request);
+
+    if (!g_addressindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled; start with -addressindex");
+
+    auto address = ParseAddress(request.params[0]);
+
+    // the index has caught up with at least this tip once synced
+    int height;
+    {
+        LOCK(cs_main);
+        height = ::ChainActive().Height();
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Addresses are still in the process of being indexed.");
+
+    if (!request.params[1].isNull()) {
+        int requested = request.params[1].get_int();
+        if (requested < 0 || requested > height)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        height = requested;
+    }
+
+    CAmount balance, received;
+    g_addressindex->GetAddressBalance(address, height, balance, received);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("height", height);
+    ret.pushKV("balance", ValueFromAmount(balance));
+    ret.pushKV("received", ValueFromAmount(received));
+    return ret;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getspentinfo",
+                "\nReturns the transaction input spending an output in the active chain.\n"
+                "Requires -spentindex.\n",
+                {
+                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id of the output"},
+                    {"n", RPCArg::Type::NUM, RPCArg::Optional::NO, "vout number"},
+                },
+                RPCResult{
+            "{                          (json object, or null if the output is unspent or unknown)\n"
+            "  \"txid\" : \"hash\",        (string) The spending transaction id\n"
+            "  \"vin\" : n,              (numeric) The index of the spending input\n"
+            "  \"height\" : n,           (numeric) The height of the block the spending transaction is in\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getspentinfo", "\"txid\" 1")
+            + HelpExampleRpc("getspentinfo", "\"txid\", 1")
+                },
+            }.Check(request);
+
+    if (!g_spentindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is not enabled; start with -spentindex");
+
+    uint256 hash(ParseHashV(request.params[0], "txid"));
+    int n = request.params[1].get_int();
+    if (n < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "vout should not be a negative value");
+
+    if (!g_spentindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent outputs are still in the process of being indexed.");
+
+    CSpentIndexValue value;
+    if (!g_spentindex->FindSpend(COutPoint(hash, n), value))
+        return NullUniValue;
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("txid", value.txId.GetHex());
+    ret.pushKV("vin", int(value.nIn));
+    ret.pushKV("height", value.nHeight);
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2293,6 +2473,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address", "skip", "count"} },
+    { "blockchain",         "getaddressbalance",      &getaddressbalance,      {"address", "height"} },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           {"txid", "n"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
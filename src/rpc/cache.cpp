@@ -0,0 +1,143 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#include <rpc/cache.h>
+
+#include <chain.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <map>
+
+RPCResultCache g_rpc_result_cache;
+
+// the calls whose reply is fixed by the block they name, and the position of its hash in their params
+static const std::map<std::string, size_t> cacheableMethods = {
+    {"getblock", 0},
+    {"getblockheader", 0},
+    {"getchangesinblock", 0},
+    {"getnamesintrie", 0},
+    {"getvalueforname", 1},
+    {"getclaimsforname", 1},
+    {"getclaimbybid", 2},
+    {"getclaimbyseq", 2},
+    {"getnameproof", 1},
+    {"getclaimproofbybid", 2},
+    {"getclaimproofbyseq", 2},
+};
+
+// rough memory taken by a reply, which is what the cache size limits
+static size_t DynamicUsage(const UniValue& value)
+{
+    size_t usage = sizeof(UniValue) + value.getValStr().size();
+    if (value.isObject()) {
+        for (const auto& key : value.getKeys())
+            usage += sizeof(std::string) + key.size();
+    }
+    if (value.isObject() || value.isArray()) {
+        for (const auto& child : value.getValues())
+            usage += DynamicUsage(child);
+    }
+    return usage;
+}
+
+void RPCResultCache::Evict(size_t max_usage)
+{
+    while (m_usage > max_usage) {
+        auto& entry = m_entries.back();
+        m_usage -= entry.usage;
+        m_index.erase(entry.key);
+        m_entries.pop_back();
+    }
+}
+
+void RPCResultCache::Configure(size_t max_bytes, int min_depth)
+{
+    LOCK(m_mutex);
+    m_max_usage = max_bytes;
+    m_min_depth = std::max(min_depth, 1);
+    Evict(m_max_usage);
+}
+
+bool RPCResultCache::Lookup(const JSONRPCRequest& request, std::string& key, UniValue& result)
+{
+    key.clear();
+    {
+        LOCK(m_mutex);
+        if (m_max_usage == 0)
+            return false;
+    }
+    auto it = cacheableMethods.find(request.strMethod);
+    if (it == cacheableMethods.end() || !request.params.isArray() || request.params.size() <= it->second)
+        return false;
+    const auto& hashParam = request.params[it->second];
+    if (!hashParam.isStr() || hashParam.get_str().size() != 64 || !IsHex(hashParam.get_str()))
+        return false;
+
+    // positional params, with the hash in lowercase and no trailing nulls
+    const auto hash = uint256S(hashParam.get_str());
+    auto params = request.params.getValues();
+    params[it->second] = hash.GetHex();
+    while (!params.empty() && params.back().isNull())
+        params.pop_back();
+    UniValue canonical(UniValue::VARR);
+    canonical.push_backV(params);
+    const std::string callKey = request.strMethod + canonical.write();
+
+    int confirmations;
+    {
+        LOCK2(cs_main, m_mutex);
+        auto pindex = LookupBlockIndex(hash);
+        if (!pindex || !::ChainActive().Contains(pindex))
+            return false;
+        confirmations = ::ChainActive().Height() - pindex->nHeight + 1;
+        if (confirmations <= m_min_depth)
+            return false;
+
+        auto entry = m_index.find(callKey);
+        if (entry == m_index.end()) {
+            ++m_misses;
+            key = callKey;
+            return false;
+        }
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, entry->second);
+        result = entry->second->result;
+    }
+    if (result.isObject() && result["confirmations"].isNum())
+        result.pushKV("confirmations", confirmations);
+    return true;
+}
+
+void RPCResultCache::Insert(const std::string& key, const UniValue& result)
+{
+    const size_t usage = sizeof(Entry) + 2 * key.size() + DynamicUsage(result);
+    LOCK(m_mutex);
+    if (usage > m_max_usage || m_index.count(key))
+        return;
+    Evict(m_max_usage - usage);
+    m_entries.push_front({key, result, usage});
+    m_index.emplace(key, m_entries.begin());
+    m_usage += usage;
+}
+
+void RPCResultCache::Clear()
+{
+    LOCK(m_mutex);
+    Evict(0);
+}
+
+UniValue RPCResultCache::GetInfo() const
+{
+    LOCK(m_mutex);
+    UniValue info(UniValue::VOBJ);
+    info.pushKV("entries", (uint64_t)m_entries.size());
+    info.pushKV("usage", (uint64_t)m_usage);
+    info.pushKV("max_usage", (uint64_t)m_max_usage);
+    info.pushKV("min_depth", m_min_depth);
+    info.pushKV("hits", m_hits);
+    info.pushKV("misses", m_misses);
+    return info;
+}
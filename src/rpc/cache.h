@@ -0,0 +1,69 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_CACHE_H
+#define BITCOIN_RPC_CACHE_H
+
+#include <rpc/request.h>
+#include <sync.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <univalue.h>
+
+/** Default for -rpccachesize, in MiB; the cache is off unless set */
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 0;
+/** Default for -rpccachedepth, how far below the tip a block has to be for results about it to be cached */
+static const int DEFAULT_RPC_CACHE_DEPTH = 100;
+
+/**
+ * Replies to calls addressed to a block by its hash (getblock, getblockheader, getchangesinblock
+ * and the claim queries taking a blockhash), kept when the block is buried deep enough on the
+ * active chain that they won't change anymore. Entries are keyed by method and positional params,
+ * and evicted least recently used first. The one part of such a reply that does change, the
+ * "confirmations" of getblock and getblockheader, is brought up to date on every hit.
+ */
+class RPCResultCache
+{
+    struct Entry {
+        std::string key;
+        UniValue result;
+        size_t usage;
+    };
+
+    mutable Mutex m_mutex;
+    std::list<Entry> m_entries GUARDED_BY(m_mutex); // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex) = 0;
+    size_t m_max_usage GUARDED_BY(m_mutex) = 0;
+    int m_min_depth GUARDED_BY(m_mutex) = DEFAULT_RPC_CACHE_DEPTH;
+    uint64_t m_hits GUARDED_BY(m_mutex) = 0;
+    uint64_t m_misses GUARDED_BY(m_mutex) = 0;
+
+    void Evict(size_t max_usage) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    /** Limit the cache to max_bytes (0 turns it off), for blocks at least min_depth below the tip */
+    void Configure(size_t max_bytes, int min_depth);
+
+    /**
+     * Look up the reply to a call with positional params. Returns true with result set on a hit.
+     * On a miss that could be cached, key is set for Insert to store the reply under; otherwise
+     * it's left empty.
+     */
+    bool Lookup(const JSONRPCRequest& request, std::string& key, UniValue& result);
+    void Insert(const std::string& key, const UniValue& result);
+
+    /** Drop every entry, for when the active chain changes below the cache depth */
+    void Clear();
+
+    /** Size, limits and hit counts, for getrpcinfo */
+    UniValue GetInfo() const;
+};
+
+extern RPCResultCache g_rpc_result_cache;
+
+#endif // BITCOIN_RPC_CACHE_H
@@ -0,0 +1,447 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#include <rpc/cbor.h>
+
+#include <rpc/claimrpcdefs.h>
+#include <util/strencodings.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+
+namespace {
+
+enum : uint8_t {
+    MAJOR_UNSIGNED = 0,
+    MAJOR_NEGATIVE = 1,
+    MAJOR_BYTES = 2,
+    MAJOR_TEXT = 3,
+    MAJOR_ARRAY = 4,
+    MAJOR_MAP = 5,
+    MAJOR_TAG = 6,
+    MAJOR_SIMPLE = 7,
+};
+
+enum : uint8_t {
+    SIMPLE_FALSE = 20,
+    SIMPLE_TRUE = 21,
+    SIMPLE_NULL = 22,
+    SIMPLE_UNDEFINED = 23,
+    SIMPLE_HALF = 25,
+    SIMPLE_FLOAT = 26,
+    SIMPLE_DOUBLE = 27,
+};
+
+const uint64_t TAG_DECIMAL_FRACTION = 4;
+
+// deeper than anything our RPCs take or return, and it keeps the decoder's recursion bounded
+const int MAX_DEPTH = 256;
+// a decimal fraction is written out as digits, so keep its exponent sensible
+const int64_t MAX_DECIMAL_EXPONENT = 1000;
+
+void WriteBigEndian(std::string& out, uint64_t n, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i)
+        out.push_back(char(n >> (8 * i)));
+}
+
+void WriteHead(std::string& out, uint8_t major, uint64_t n)
+{
+    const uint8_t initial = major << 5;
+    if (n < 24) {
+        out.push_back(char(initial | n));
+    } else if (n <= 0xff) {
+        out.push_back(char(initial | 24));
+        WriteBigEndian(out, n, 1);
+    } else if (n <= 0xffff) {
+        out.push_back(char(initial | 25));
+        WriteBigEndian(out, n, 2);
+    } else if (n <= 0xffffffff) {
+        out.push_back(char(initial | 26));
+        WriteBigEndian(out, n, 4);
+    } else {
+        out.push_back(char(initial | 27));
+        WriteBigEndian(out, n, 8);
+    }
+}
+
+void WriteInt(std::string& out, int64_t n)
+{
+    if (n < 0)
+        WriteHead(out, MAJOR_NEGATIVE, uint64_t(-1 - n));
+    else
+        WriteHead(out, MAJOR_UNSIGNED, uint64_t(n));
+}
+
+void WriteDouble(std::string& out, double d)
+{
+    uint64_t bits;
+    static_assert(sizeof(bits) == sizeof(d), "double must be 64 bits");
+    std::memcpy(&bits, &d, sizeof(bits));
+    out.push_back(char((MAJOR_SIMPLE << 5) | SIMPLE_DOUBLE));
+    WriteBigEndian(out, bits, 8);
+}
+
+// members whose strings are hex whatever they hold; anything else might merely look like it
+bool IsHexKey(const std::string& key)
+{
+    static const std::set<std::string> keys{
+        "bestblockhash", "chainwork", "coinbase", "hex", "merkleroot", "nameclaimroot", "nextblockhash",
+        "previousblockhash", "txid", "txinwitness", "wtxid",
+        T_BLOCKHASH, T_CLAIMID, T_HASH, T_NODEHASH, T_SPENTTXID, T_TXID, T_VALUEHASH,
+    };
+    return keys.count(key) != 0;
+}
+
+// methods whose result is hex, or a list of it, whenever it's a string; objects they return go by key
+bool IsHexResultMethod(const std::string& method)
+{
+    static const std::set<std::string> methods{
+        "createrawtransaction", "generatetoaddress", "getbestblockhash", "getblock", "getblockhash",
+        "getblockheader", "getrawmempool", "getrawtransaction", "gettxoutproof", "sendmany",
+        "sendrawtransaction", "sendtoaddress",
+    };
+    return methods.count(method) != 0;
+}
+
+bool IsLowerHex(const std::string& str)
+{
+    if (str.empty() || str.size() % 2)
+        return false;
+    for (char c : str)
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+            return false;
+    return true;
+}
+
+void WriteNumber(std::string& out, const std::string& str)
+{
+    // UniValue keeps numbers as JSON text: -?digits(.digits)?([eE][+-]?digits)?
+    std::size_t i = 0;
+    const bool negative = i < str.size() && str[i] == '-';
+    if (negative)
+        ++i;
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    bool fraction = false, overflow = false;
+    auto digit = [&](char c) {
+        const uint64_t d = c - '0';
+        if (mantissa > (std::numeric_limits<uint64_t>::max() - d) / 10)
+            overflow = true;
+        mantissa = mantissa * 10 + d;
+    };
+    for (; i < str.size() && IsDigit(str[i]); ++i)
+        digit(str[i]);
+    if (i < str.size() && str[i] == '.') {
+        fraction = true;
+        for (++i; i < str.size() && IsDigit(str[i]); ++i, --exponent)
+            digit(str[i]);
+    }
+    if (i < str.size() && (str[i] == 'e' || str[i] == 'E')) {
+        int64_t e;
+        std::string rest = str.substr(i + 1);
+        if (!rest.empty() && rest[0] == '+')
+            rest.erase(0, 1);
+        if (!ParseInt64(rest, &e) || e > MAX_DECIMAL_EXPONENT || e < -MAX_DECIMAL_EXPONENT)
+            overflow = true;
+        else
+            exponent += e;
+        fraction = true;
+        i = str.size();
+    }
+
+    if (i != str.size() || overflow || (fraction && mantissa > uint64_t(std::numeric_limits<int64_t>::max()))) {
+        double d = 0;
+        if (ParseDouble(str, &d)) {
+            WriteDouble(out, d);
+        } else {
+            WriteHead(out, MAJOR_TEXT, str.size());
+            out.append(str);
+        }
+        return;
+    }
+
+    if (!fraction) {
+        if (negative && mantissa)
+            WriteHead(out, MAJOR_NEGATIVE, mantissa - 1);
+        else
+            WriteHead(out, MAJOR_UNSIGNED, mantissa);
+        return;
+    }
+
+    WriteHead(out, MAJOR_TAG, TAG_DECIMAL_FRACTION);
+    WriteHead(out, MAJOR_ARRAY, 2);
+    WriteInt(out, exponent);
+    WriteInt(out, negative ? -int64_t(mantissa) : int64_t(mantissa));
+}
+
+void Write(std::string& out, const UniValue& value, bool hex)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        out.push_back(char((MAJOR_SIMPLE << 5) | SIMPLE_NULL));
+        break;
+    case UniValue::VBOOL:
+        out.push_back(char((MAJOR_SIMPLE << 5) | (value.get_bool() ? SIMPLE_TRUE : SIMPLE_FALSE)));
+        break;
+    case UniValue::VNUM:
+        WriteNumber(out, value.getValStr());
+        break;
+    case UniValue::VSTR: {
+        const auto& str = value.get_str();
+        if (hex && IsLowerHex(str)) {
+            WriteHead(out, MAJOR_BYTES, str.size() / 2);
+            for (std::size_t i = 0; i < str.size(); i += 2)
+                out.push_back(char((HexDigit(str[i]) << 4) | HexDigit(str[i + 1])));
+        } else {
+            WriteHead(out, MAJOR_TEXT, str.size());
+            out.append(str);
+        }
+        break;
+    }
+    case UniValue::VARR:
+        WriteHead(out, MAJOR_ARRAY, value.size());
+        for (std::size_t i = 0; i < value.size(); ++i)
+            Write(out, value[i], hex);
+        break;
+    case UniValue::VOBJ: {
+        const auto& keys = value.getKeys();
+        const auto& values = value.getValues();
+        WriteHead(out, MAJOR_MAP, keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            WriteHead(out, MAJOR_TEXT, keys[i].size());
+            out.append(keys[i]);
+            Write(out, values[i], IsHexKey(keys[i]));
+        }
+        break;
+    }
+    }
+}
+
+// a JSON-RPC reply, or a batch of them, with each result typed by the method of its request
+void WriteReply(std::string& out, const UniValue& reply, const UniValue& request)
+{
+    if (reply.isArray()) {
+        WriteHead(out, MAJOR_ARRAY, reply.size());
+        for (std::size_t i = 0; i < reply.size(); ++i)
+            WriteReply(out, reply[i], request.isArray() && i < request.size() ? request[i] : NullUniValue);
+        return;
+    }
+    if (!reply.isObject()) {
+        Write(out, reply, false);
+        return;
+    }
+    const auto& method = find_value(request, "method");
+    const bool hexResult = method.isStr() && IsHexResultMethod(method.get_str());
+    const auto& keys = reply.getKeys();
+    const auto& values = reply.getValues();
+    WriteHead(out, MAJOR_MAP, keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        WriteHead(out, MAJOR_TEXT, keys[i].size());
+        out.append(keys[i]);
+        Write(out, values[i], keys[i] == "result" ? hexResult : IsHexKey(keys[i]));
+    }
+}
+
+class CBORReader
+{
+    const std::string& m_data;
+    std::size_t m_pos = 0;
+
+    bool ReadHead(uint8_t& major, uint8_t& info, uint64_t& n)
+    {
+        if (m_pos >= m_data.size())
+            return false;
+        const uint8_t initial = m_data[m_pos++];
+        major = initial >> 5;
+        info = initial & 0x1f;
+        if (info < 24) {
+            n = info;
+            return true;
+        }
+        if (info > 27) // indefinite lengths aren't supported
+            return false;
+        const std::size_t bytes = std::size_t(1) << (info - 24);
+        if (Remaining() < bytes)
+            return false;
+        n = 0;
+        for (std::size_t i = 0; i < bytes; ++i)
+            n = (n << 8) | uint8_t(m_data[m_pos++]);
+        return true;
+    }
+
+    bool ReadInt(int64_t& value)
+    {
+        uint8_t major, info;
+        uint64_t n;
+        if (!ReadHead(major, info, n) || n > uint64_t(std::numeric_limits<int64_t>::max()))
+            return false;
+        if (major == MAJOR_UNSIGNED)
+            value = int64_t(n);
+        else if (major == MAJOR_NEGATIVE)
+            value = -1 - int64_t(n);
+        else
+            return false;
+        return true;
+    }
+
+    bool ReadDecimalFraction(UniValue& value)
+    {
+        uint8_t major, info;
+        uint64_t n;
+        int64_t exponent, mantissa;
+        if (!ReadHead(major, info, n) || major != MAJOR_ARRAY || n != 2 || !ReadInt(exponent) || !ReadInt(mantissa))
+            return false;
+        if (exponent > MAX_DECIMAL_EXPONENT || exponent < -MAX_DECIMAL_EXPONENT)
+            return false;
+        const uint64_t magnitude = mantissa < 0 ? uint64_t(-(mantissa + 1)) + 1 : uint64_t(mantissa);
+        std::string digits = std::to_string(magnitude);
+        if (exponent >= 0) {
+            digits.append(exponent, '0');
+        } else {
+            const std::size_t fraction = -exponent;
+            if (digits.size() <= fraction)
+                digits.insert(0, fraction - digits.size() + 1, '0');
+            digits.insert(digits.size() - fraction, 1, '.');
+        }
+        return value.setNumStr(mantissa < 0 ? "-" + digits : digits);
+    }
+
+    static double HalfToDouble(uint16_t half)
+    {
+        const int exponent = (half >> 10) & 0x1f;
+        const int mantissa = half & 0x3ff;
+        double d;
+        if (exponent == 0)
+            d = std::ldexp(mantissa, -24);
+        else if (exponent != 31)
+            d = std::ldexp(mantissa + 1024, exponent - 25);
+        else
+            d = mantissa ? NAN : INFINITY;
+        return half & 0x8000 ? -d : d;
+    }
+
+public:
+    explicit CBORReader(const std::string& data) : m_data(data) {}
+
+    std::size_t Remaining() const { return m_data.size() - m_pos; }
+
+    bool Read(UniValue& value, int depth)
+    {
+        uint8_t major, info;
+        uint64_t n;
+        if (depth > MAX_DEPTH || !ReadHead(major, info, n))
+            return false;
+
+        switch (major) {
+        case MAJOR_UNSIGNED:
+            value = UniValue(n);
+            return true;
+        case MAJOR_NEGATIVE:
+            if (n > uint64_t(std::numeric_limits<int64_t>::max()))
+                return false;
+            value = UniValue(-1 - int64_t(n));
+            return true;
+        case MAJOR_BYTES:
+            if (n > Remaining())
+                return false;
+            value = UniValue(HexStr(m_data.begin() + m_pos, m_data.begin() + m_pos + n));
+            m_pos += n;
+            return true;
+        case MAJOR_TEXT:
+            if (n > Remaining())
+                return false;
+            value = UniValue(m_data.substr(m_pos, n));
+            m_pos += n;
+            return true;
+        case MAJOR_ARRAY:
+            // every item takes at least a byte, which also bounds what a bogus length reserves
+            if (n > Remaining())
+                return false;
+            value.setArray();
+            for (uint64_t i = 0; i < n; ++i) {
+                UniValue item;
+                if (!Read(item, depth + 1))
+                    return false;
+                value.push_back(item);
+            }
+            return true;
+        case MAJOR_MAP:
+            if (n > Remaining() / 2)
+                return false;
+            value.setObject();
+            for (uint64_t i = 0; i < n; ++i) {
+                UniValue key, item;
+                if (m_pos >= m_data.size() || uint8_t(m_data[m_pos]) >> 5 != MAJOR_TEXT)
+                    return false;
+                if (!Read(key, depth + 1) || !Read(item, depth + 1))
+                    return false;
+                value.__pushKV(key.get_str(), item);
+            }
+            return true;
+        case MAJOR_TAG:
+            return n == TAG_DECIMAL_FRACTION && ReadDecimalFraction(value);
+        case MAJOR_SIMPLE:
+            break;
+        }
+
+        double d;
+        switch (info) {
+        case SIMPLE_FALSE:
+            value = UniValue(false);
+            return true;
+        case SIMPLE_TRUE:
+            value = UniValue(true);
+            return true;
+        case SIMPLE_NULL:
+        case SIMPLE_UNDEFINED:
+            value = NullUniValue;
+            return true;
+        case SIMPLE_HALF:
+            d = HalfToDouble(uint16_t(n));
+            break;
+        case SIMPLE_FLOAT: {
+            const uint32_t bits = uint32_t(n);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            d = f;
+            break;
+        }
+        case SIMPLE_DOUBLE:
+            std::memcpy(&d, &n, sizeof(d));
+            break;
+        default:
+            return false;
+        }
+        // JSON has no infinities or NaN
+        if (!std::isfinite(d))
+            return false;
+        value = UniValue(d);
+        return true;
+    }
+};
+
+} // namespace
+
+std::string EncodeCBOR(const UniValue& value, bool hex)
+{
+    std::string out;
+    Write(out, value, hex);
+    return out;
+}
+
+std::string EncodeCBORReply(const UniValue& reply, const UniValue& request)
+{
+    std::string out;
+    WriteReply(out, reply, request);
+    return out;
+}
+
+bool DecodeCBOR(const std::string& data, UniValue& value)
+{
+    CBORReader reader(data);
+    return reader.Read(value, 0) && reader.Remaining() == 0;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_CBOR_H
+#define BITCOIN_RPC_CBOR_H
+
+#include <string>
+
+#include <univalue.h>
+
+/** Content type of RPC requests and replies encoded with EncodeCBOR */
+static const char* const CBOR_CONTENT_TYPE = "application/cbor";
+
+/**
+ * Encode a UniValue as CBOR (RFC 7049), the compact alternative to JSON for RPC.
+ *
+ * It maps onto the same model as JSON, with two changes to save space that DecodeCBOR undoes:
+ * a string of lowercase hex digits in a field known to hold hex (txids, claimIds, hashes, hex
+ * scripts and transactions, chosen by key) becomes a byte string, and a number with a fractional
+ * part (amounts) becomes a decimal fraction (tag 4), so that it keeps its exact digits. Strings
+ * anywhere else go over as text. Pass hex to treat value itself, or the items of it if it's an
+ * array, as such a field.
+ */
+std::string EncodeCBOR(const UniValue& value, bool hex = false);
+
+/**
+ * Encode a JSON-RPC reply, or a batch of them, as EncodeCBOR would, except that the result of
+ * a method known to return hex (getblockhash, non-verbose getrawtransaction and getblock, ...)
+ * goes over as bytes too. request is what was parsed from the call, to look its method up in.
+ */
+std::string EncodeCBORReply(const UniValue& reply, const UniValue& request);
+
+/** Decode CBOR into a UniValue, byte strings becoming lowercase hex. Returns false if malformed or unsupported. */
+bool DecodeCBOR(const std::string& data, UniValue& value);
+
+#endif // BITCOIN_RPC_CBOR_H
@@ -46,5 +46,9 @@
  #define T_SUPPORTSREMOVED               "supportsRemoved"
  #define T_ADDRESS                       "address"
  #define T_PENDINGAMOUNT                 "pendingAmount"
+ #define T_SPENTTXID                     "spentTxId"
+ #define T_SPENTHEIGHT                   "spentHeight"
+ #define T_ABANDONED                     "abandoned"
+ #define T_ADDRESSES                     "addresses"
 
 #endif // CLAIMRPCDEFS_H
@@ -21,6 +21,8 @@ enum {
     GETCLAIMPROOFBYBID,
     GETCLAIMPROOFBYSEQ,
     GETCHANGESINBLOCK,
+    GETCLAIMHISTORY,
+    GETCLAIMSFORADDRESS,
 };
 
 #define S3_(pre, name, def) pre "\"" name "\"" def "\n"
@@ -386,6 +388,65 @@ RPCHelpMan{"getchangesinblock",
     },
 },
 
+// GETCLAIMHISTORY
+RPCHelpMan{"getclaimhistory",
+    S1("\nReturn every output a claim has had, its updates and supports included, oldest first.")
+    S1("Requires -claimindex."),
+    {
+        { T_CLAIMID, RPCArg::Type::STR, RPCArg::Optional::NO, "The claimId to look up" },
+    },
+    RPCResult{
+        S1("[")
+        S3("    ", T_CLAIMTYPE, "              (string) claim, update or support")
+        S3("    ", T_NAME, "                   (string) the name in the output script")
+        S3("    ", T_TXID, "                   (string) the txid of the output")
+        S3("    ", T_N, "                      (numeric) the index of the output in the transaction's list of outputs")
+        S3("    ", T_AMOUNT, "                 (numeric) the amount of the output")
+        S3("    ", T_HEIGHT, "                 (numeric) the height of the block in which the output was created")
+        S3("    ", T_SPENTTXID, "              (string, if spent) the txid of the transaction that spent it")
+        S3("    ", T_SPENTHEIGHT, "            (numeric, if spent) the height of the block in which it was spent")
+        S3("    ", T_ABANDONED, "              (boolean, if spent) whether it was abandoned rather than updated")
+        "]",
+    },
+    RPCExamples{
+        HelpExampleCli("getclaimhistory", "\"2be6b1e8f2a5d8b4f69cb8a3f4a6a4d6e7e12c43\"")
+        + HelpExampleRpc("getclaimhistory", "\"2be6b1e8f2a5d8b4f69cb8a3f4a6a4d6e7e12c43\"")
+    },
+},
+
+// GETCLAIMSFORADDRESS
+RPCHelpMan{"getclaimsforaddress",
+    S1("\nReturn the unspent claims and supports paying to any of the given addresses, pending ones in the mempool included."),
+    {
+        { T_ADDRESSES, RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses to look up",
+            {
+                { T_ADDRESS, RPCArg::Type::STR, RPCArg::Optional::OMITTED, "an address" },
+            },
+        },
+    },
+    RPCResult{
+        S1("[")
+        S3("    ", T_ADDRESS, "                (string) the address the output pays to")
+        S3("    ", T_TXID, "                   (string) the txid of the output")
+        S3("    ", T_AMOUNT, "                 (numeric) the amount of the output")
+        S3("    ", T_N, "                      (numeric) the index of the output in the transaction's list of outputs")
+        S3("    ", T_NAME, "                   (string) the name claimed or supported")
+        S3("    ", T_CLAIMID, "                (string) the claimId claimed or supported")
+        S3("    ", T_VALUE, "                  (string) if a claim or a support with metadata, its value")
+        S3("    ", T_DEPTH, "                  (numeric) the depth of the transaction in the main chain, 0 in the mempool")
+        S3("    ", T_INCLAIMTRIE, "            (boolean) if a name claim, whether the claim is active, i.e. has made it into the trie")
+        S3("    ", T_ISCONTROLLING, "          (boolean) if a name claim, whether the claim is the current controlling claim for the name")
+        S3("    ", T_INSUPPORTMAP, "           (boolean) if a support, whether the support is active, i.e. has made it into the support map")
+        S3("    ", T_INQUEUE, "                (boolean) whether the claim is in a queue waiting to be inserted into the trie or support map")
+        S3("    ", T_BLOCKSTOVALID, "          (numeric) if in a queue, the number of blocks until it's inserted into the trie or support map")
+        "]",
+    },
+    RPCExamples{
+        HelpExampleCli("getclaimsforaddress", "\"[\\\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\\\"]\"")
+        + HelpExampleRpc("getclaimsforaddress", "[\"bPmKvePBdNBaWZRcmvTTdUcw6sgpNAsAuz\"]")
+    },
+},
+
 };
 
 #endif // CLAIMRPCHELP_H
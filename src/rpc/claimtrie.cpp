@@ -2,6 +2,7 @@
 #include <claimtrie/forks.h>
 #include <coins.h>
 #include <core_io.h>
+#include <index/claimindex.h>
 #include <key_io.h>
 #include <logging.h>
 #include <nameclaim.h>
@@ -15,12 +16,14 @@
 #include <txmempool.h>
 #include <undo.h>
 #include <univalue.h>
+#include <univalue_builder.h>
 #include <util/strencodings.h>
 #include <validation.h>
 
 #include <boost/locale.hpp>
 #include <boost/thread.hpp>
 #include <cmath>
+#include <set>
 
 static constexpr size_t claimIdHexLength = 40;
 
@@ -79,6 +82,21 @@ void RollBackTo(const CBlockIndex* targetIndex, CCoinsViewCache& coinsCache, CCl
     trieCache.getMerkleHash(); // update the hash tree
 }
 
+// the claims for name as of blockIndex (the tip if null): read straight from the archive when
+// -claimtriearchive covers it, rolled back to otherwise
+static CClaimSupportToName ClaimsForNameAt(const std::string& name, const CBlockIndex* blockIndex,
+                                           CCoinsViewCache& coinsCache, CClaimTrieCache& trieCache)
+{
+    AssertLockHeld(cs_main);
+
+    if (blockIndex && blockIndex != ::ChainActive().Tip()) {
+        if (trieCache.isArchived(blockIndex->nHeight))
+            return trieCache.getClaimsForNameAt(name, blockIndex->nHeight);
+        RollBackTo(blockIndex, coinsCache, trieCache);
+    }
+    return trieCache.getClaimsForName(name);
+}
+
 std::string escapeNonUtf8(const std::string& name)
 {
     using namespace boost::locale::conv;
@@ -140,20 +158,36 @@ std::size_t indexOf(const std::vector<CClaimNsupports>& source, const uint160& c
     return std::distance(source.begin(), it);
 }
 
+// the output itself; claims read from the archive may have been spent since, so fall back on -txindex
+static bool LookupOutput(const CCoinsViewCache& coinsCache, const COutPoint& outPoint, CTxOut& out)
+{
+    auto& coin = coinsCache.AccessCoin(outPoint);
+    if (!coin.IsSpent()) {
+        out = coin.out;
+        return true;
+    }
+    CTransactionRef tx;
+    uint256 hashBlock;
+    if (!GetTransaction(outPoint.hash, tx, Params().GetConsensus(), hashBlock) || outPoint.n >= tx->vout.size())
+        return false;
+    out = tx->vout[outPoint.n];
+    return true;
+}
+
 UniValue claimToJSON(const CCoinsViewCache& coinsCache, const CClaimValue& claim)
 {
     UniValue result(UniValue::VOBJ);
 
-    auto& coin = coinsCache.AccessCoin(COutPoint(claim.outPoint));
-    if (!coin.IsSpent()) {
+    CTxOut out;
+    if (LookupOutput(coinsCache, COutPoint(claim.outPoint), out)) {
         std::string name, value;
-        if (extractValue(coin.out.scriptPubKey, name, value)) {
+        if (extractValue(out.scriptPubKey, name, value)) {
             result.pushKV(T_NAME, escapeNonUtf8(name));
             result.pushKV(T_VALUE, value);
         }
 
         CTxDestination address;
-        if (ExtractDestination(coin.out.scriptPubKey, address))
+        if (ExtractDestination(out.scriptPubKey, address))
             result.pushKV(T_ADDRESS, EncodeDestination(address));
     }
 
@@ -171,16 +205,16 @@ UniValue supportToJSON(const CCoinsViewCache& coinsCache, const CSupportValue& s
 {
     UniValue ret(UniValue::VOBJ);
 
-    auto& coin = coinsCache.AccessCoin(COutPoint(support.outPoint));
-    if (!coin.IsSpent()) {
+    CTxOut out;
+    if (LookupOutput(coinsCache, COutPoint(support.outPoint), out)) {
         std::string name, value;
-        if (extractValue(coin.out.scriptPubKey, name, value)) {
+        if (extractValue(out.scriptPubKey, name, value)) {
             ret.pushKV(T_NAME, name);
             ret.pushKV(T_VALUE, value);
         }
 
         CTxDestination address;
-        if (ExtractDestination(coin.out.scriptPubKey, address))
+        if (ExtractDestination(out.scriptPubKey, address))
             ret.pushKV(T_ADDRESS, EncodeDestination(address));
     }
 
@@ -216,10 +250,11 @@ UniValue claimAndSupportsToJSON(const CCoinsViewCache& coinsCache, const CClaimN
         result.pushKV(T_PENDINGAMOUNT, fullAmount);
 
     UniValue supportObjs(UniValue::VARR);
+    UniValueReserve(supportObjs, supports.size());
     for (auto& support : supports)
-        supportObjs.push_back(supportToJSON(coinsCache, support));
+        PushBackMove(supportObjs, supportToJSON(coinsCache, support));
 
-    result.pushKV(T_SUPPORTS, supportObjs);
+    PushKVMove(result, T_SUPPORTS, std::move(supportObjs));
 
     return result;
 }
@@ -245,7 +280,7 @@ static UniValue getnamesintrie(const JSONRPCRequest& request)
 
     UniValue ret(UniValue::VARR);
     trieCache.getNamesInTrie([&ret](const std::string& name) {
-        ret.push_back(escapeNonUtf8(name));
+        PushBackMove(ret, UniValue(escapeNonUtf8(name)));
 
         if (ShutdownRequested())
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Shutdown requested");
@@ -263,10 +298,9 @@ static UniValue getvalueforname(const JSONRPCRequest& request)
     auto trieCache = ::ClaimtrieCache();
     CCoinsViewCache coinsCache(&::ChainstateActive().CoinsTip());
 
-    if (request.params.size() > 1) {
-        CBlockIndex* blockIndex = BlockHashIndex(ParseHashV(request.params[1], T_BLOCKHASH " (optional parameter 2)"));
-        RollBackTo(blockIndex, coinsCache, trieCache);
-    }
+    CBlockIndex* blockIndex = nullptr;
+    if (request.params.size() > 1)
+        blockIndex = BlockHashIndex(ParseHashV(request.params[1], T_BLOCKHASH " (optional parameter 2)"));
 
     std::string claimId;
     if (request.params.size() > 2)
@@ -275,7 +309,7 @@ static UniValue getvalueforname(const JSONRPCRequest& request)
     const auto name = request.params[0].get_str();
     UniValue ret(UniValue::VOBJ);
 
-    auto csToName = trieCache.getClaimsForName(name);
+    auto csToName = ClaimsForNameAt(name, blockIndex, coinsCache, trieCache);
     if (csToName.claimsNsupports.empty())
         return ret;
 
@@ -311,13 +345,12 @@ UniValue getclaimsforname(const JSONRPCRequest& request)
     auto trieCache = ::ClaimtrieCache();
     CCoinsViewCache coinsCache(&::ChainstateActive().CoinsTip());
 
-    if (request.params.size() > 1) {
-        CBlockIndex* blockIndex = BlockHashIndex(ParseHashV(request.params[1], T_BLOCKHASH " (optional parameter 2)"));
-        RollBackTo(blockIndex, coinsCache, trieCache);
-    }
+    CBlockIndex* blockIndex = nullptr;
+    if (request.params.size() > 1)
+        blockIndex = BlockHashIndex(ParseHashV(request.params[1], T_BLOCKHASH " (optional parameter 2)"));
 
     std::string name = request.params[0].get_str();
-    auto csToName = trieCache.getClaimsForName(name);
+    auto csToName = ClaimsForNameAt(name, blockIndex, coinsCache, trieCache);
 
     UniValue result(UniValue::VOBJ);
     result.pushKV(T_NORMALIZEDNAME, escapeNonUtf8(csToName.name));
@@ -325,24 +358,49 @@ UniValue getclaimsforname(const JSONRPCRequest& request)
     auto seqOrder = seqSort(csToName.claimsNsupports);
 
     UniValue claimObjs(UniValue::VARR);
+    UniValueReserve(claimObjs, csToName.claimsNsupports.size());
     for (std::size_t i = 0; i < csToName.claimsNsupports.size(); ++i) {
         auto& claimNsupports = csToName.claimsNsupports[i];
         auto claim = claimAndSupportsToJSON(coinsCache, claimNsupports);
         claim.pushKV(T_BID, (int)i);
         claim.pushKV(T_SEQUENCE, (int)indexOf(seqOrder, claimNsupports.claim.claimId));
-        claimObjs.push_back(claim);
+        PushBackMove(claimObjs, std::move(claim));
     }
 
     UniValue unmatchedSupports(UniValue::VARR);
+    UniValueReserve(unmatchedSupports, csToName.unmatchedSupports.size());
     for (auto& support : csToName.unmatchedSupports)
-        unmatchedSupports.push_back(supportToJSON(coinsCache, support));
+        PushBackMove(unmatchedSupports, supportToJSON(coinsCache, support));
 
-    result.pushKV(T_CLAIMS, claimObjs);
+    PushKVMove(result, T_CLAIMS, std::move(claimObjs));
     result.pushKV(T_LASTTAKEOVERHEIGHT, csToName.nLastTakeoverHeight);
-    result.pushKV(T_SUPPORTSWITHOUTCLAIM, unmatchedSupports);
+    PushKVMove(result, T_SUPPORTSWITHOUTCLAIM, std::move(unmatchedSupports));
     return result;
 }
 
+// the claim for name at rank in bid (or sequence) order as of blockIndex (the tip if null); ranked by the
+// database unless it has to come from the archive, which holds all of the claims for the name anyway
+static CClaimSupportToName ClaimForNameByRankAt(const std::string& name, int rank, bool bySequence, const CBlockIndex* blockIndex,
+                                                CCoinsViewCache& coinsCache, CClaimTrieCache& trieCache, int& bid, int& seq)
+{
+    AssertLockHeld(cs_main);
+
+    if (blockIndex && blockIndex != ::ChainActive().Tip() && trieCache.isArchived(blockIndex->nHeight)) {
+        auto csToName = trieCache.getClaimsForNameAt(name, blockIndex->nHeight);
+        auto& claimsNsupports = csToName.claimsNsupports;
+        if (uint32_t(rank) >= claimsNsupports.size())
+            return {csToName.name, csToName.nLastTakeoverHeight, {}, {}};
+        auto seqOrder = seqSort(claimsNsupports);
+        auto& claimNsupports = bySequence ? seqOrder[rank] : claimsNsupports[rank];
+        bid = indexOf(claimsNsupports, claimNsupports.claim.claimId);
+        seq = indexOf(seqOrder, claimNsupports.claim.claimId);
+        return {csToName.name, csToName.nLastTakeoverHeight, {claimNsupports}, {}};
+    }
+    if (blockIndex && blockIndex != ::ChainActive().Tip())
+        RollBackTo(blockIndex, coinsCache, trieCache);
+    return trieCache.getClaimForNameByRank(name, rank, bySequence, bid, seq);
+}
+
 UniValue getclaimbybid(const JSONRPCRequest& request)
 {
     rpc_help[GETCLAIMBYBID].Check(request);
@@ -358,31 +416,24 @@ UniValue getclaimbybid(const JSONRPCRequest& request)
     if (bid < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, T_BID " (parameter 2) should not be a negative value");
 
-    if (request.params.size() > 2) {
-        CBlockIndex* blockIndex = BlockHashIndex(ParseHashV(request.params[2], T_BLOCKHASH " (optional parameter 3)"));
-        RollBackTo(blockIndex, coinsCache, trieCache);
-    }
+    CBlockIndex* blockIndex = nullptr;
+    if (request.params.size() > 2)
+        blockIndex = BlockHashIndex(ParseHashV(request.params[2], T_BLOCKHASH " (optional parameter 3)"));
 
     std::string name = request.params[0].get_str();
-    auto csToName = trieCache.getClaimsForName(name);
+    int seq = 0;
+    auto csToName = ClaimForNameByRankAt(name, bid, false, blockIndex, coinsCache, trieCache, bid, seq);
 
     UniValue result(UniValue::VOBJ);
 
-    if (uint32_t(bid) >= csToName.claimsNsupports.size())
+    if (csToName.claimsNsupports.empty())
         return result;
 
-    auto& claimNsupports = csToName.claimsNsupports[bid];
-    std::size_t seq = 0;
-    if (csToName.claimsNsupports.size() > 1) {
-        auto seqOrder = seqSort(csToName.claimsNsupports);
-        seq = indexOf(seqOrder, claimNsupports.claim.claimId);
-    }
-
     result.pushKV(T_NORMALIZEDNAME, escapeNonUtf8(csToName.name));
-    result.pushKVs(claimAndSupportsToJSON(coinsCache, claimNsupports));
+    result.pushKVs(claimAndSupportsToJSON(coinsCache, csToName.claimsNsupports[0]));
     result.pushKV(T_LASTTAKEOVERHEIGHT, csToName.nLastTakeoverHeight);
     result.pushKV(T_BID, bid);
-    result.pushKV(T_SEQUENCE, (int)seq);
+    result.pushKV(T_SEQUENCE, seq);
     return result;
 }
 
@@ -401,32 +452,23 @@ UniValue getclaimbyseq(const JSONRPCRequest& request)
     if (seq < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, T_SEQUENCE " (parameter 2) should not be a negative value");
 
-    if (request.params.size() > 2) {
-        CBlockIndex* blockIndex = BlockHashIndex(ParseHashV(request.params[2], T_BLOCKHASH " (optional parameter 3)"));
-        RollBackTo(blockIndex, coinsCache, trieCache);
-    }
+    CBlockIndex* blockIndex = nullptr;
+    if (request.params.size() > 2)
+        blockIndex = BlockHashIndex(ParseHashV(request.params[2], T_BLOCKHASH " (optional parameter 3)"));
 
     std::string name = request.params[0].get_str();
-    auto csToName = trieCache.getClaimsForName(name);
+    int bid = 0;
+    auto csToName = ClaimForNameByRankAt(name, seq, true, blockIndex, coinsCache, trieCache, bid, seq);
 
     UniValue result(UniValue::VOBJ);
 
-    if (uint32_t(seq) >= csToName.claimsNsupports.size())
+    if (csToName.claimsNsupports.empty())
         return result;
 
-    std::size_t bid = 0;
-    const auto claimNsupports = [&bid, &seq, &csToName]() -> CClaimNsupports {
-        if (csToName.claimsNsupports.size() == 1)
-            return csToName.claimsNsupports[0];
-        auto claimNsupports = seqSort(csToName.claimsNsupports)[seq];
-        bid = indexOf(csToName.claimsNsupports, claimNsupports.claim.claimId);
-        return claimNsupports;
-    }();
-
     result.pushKV(T_NORMALIZEDNAME, escapeNonUtf8(csToName.name));
-    result.pushKVs(claimAndSupportsToJSON(coinsCache, claimNsupports));
+    result.pushKVs(claimAndSupportsToJSON(coinsCache, csToName.claimsNsupports[0]));
     result.pushKV(T_LASTTAKEOVERHEIGHT, csToName.nLastTakeoverHeight);
-    result.pushKV(T_BID, (int)bid);
+    result.pushKV(T_BID, bid);
     result.pushKV(T_SEQUENCE, seq);
     return result;
 }
@@ -501,6 +543,70 @@ UniValue gettotalvalueofclaims(const JSONRPCRequest& request)
     return ValueFromAmount(total_amount);
 }
 
+// the claim or support in an output and where it stands in the trie; nHeight is 0 while in the mempool
+static bool claimOutputToJSON(CClaimTrieCache& trieCache, const COutPoint& outPoint, const CTxOut& txout, int nHeight, UniValue& o)
+{
+    int op;
+    std::vector<std::vector<unsigned char> > vvchParams;
+    if (!DecodeClaimScript(txout.scriptPubKey, op, vvchParams))
+        return false;
+
+    const auto& hash = outPoint.hash;
+    const auto i = outPoint.n;
+    o.pushKV(T_N, static_cast<int64_t>(i));
+    std::string sName(vvchParams[0].begin(), vvchParams[0].end());
+    o.pushKV(T_NAME, escapeNonUtf8(sName));
+    if (op == OP_CLAIM_NAME) {
+        uint160 claimId = ClaimIdHash(hash, i);
+        o.pushKV(T_CLAIMID, claimId.GetHex());
+        o.pushKV(T_VALUE, HexStr(vvchParams[1].begin(), vvchParams[1].end()));
+    } else if (op == OP_UPDATE_CLAIM || op == OP_SUPPORT_CLAIM) {
+        uint160 claimId(vvchParams[1]);
+        o.pushKV(T_CLAIMID, claimId.GetHex());
+        if (vvchParams.size() > 2)
+            o.pushKV(T_VALUE, HexStr(vvchParams[2].begin(), vvchParams[2].end()));
+    }
+    if (nHeight > 0) {
+        o.pushKV(T_DEPTH, ::ChainActive().Height() - nHeight);
+        if (op == OP_CLAIM_NAME || op == OP_UPDATE_CLAIM) {
+            bool inClaimTrie = trieCache.haveClaim(sName, outPoint);
+            o.pushKV(T_INCLAIMTRIE, inClaimTrie);
+            if (inClaimTrie) {
+                CClaimValue claim;
+                if (!trieCache.getInfoForName(sName, claim))
+                    LogPrintf("HaveClaim was true but getInfoForName returned false.");
+                o.pushKV(T_ISCONTROLLING, (claim.outPoint.hash == hash && claim.outPoint.n == i));
+            } else {
+                int nValidAtHeight;
+                if (trieCache.haveClaimInQueue(sName, outPoint, nValidAtHeight)) {
+                    o.pushKV(T_INQUEUE, true);
+                    o.pushKV(T_BLOCKSTOVALID, nValidAtHeight - ::ChainActive().Height());
+                } else
+                    o.pushKV(T_INQUEUE, false);
+                }
+        } else if (op == OP_SUPPORT_CLAIM) {
+            bool inSupportMap = trieCache.haveSupport(sName, outPoint);
+            o.pushKV(T_INSUPPORTMAP, inSupportMap);
+            if (!inSupportMap) {
+                int nValidAtHeight;
+                if (trieCache.haveSupportInQueue(sName, outPoint, nValidAtHeight)) {
+                    o.pushKV(T_INQUEUE, true);
+                    o.pushKV(T_BLOCKSTOVALID, nValidAtHeight - ::ChainActive().Height());
+                } else
+                    o.pushKV(T_INQUEUE, false);
+            }
+        }
+    } else {
+        o.pushKV(T_DEPTH, 0);
+        if (op == OP_CLAIM_NAME || op == OP_UPDATE_CLAIM)
+            o.pushKV(T_INCLAIMTRIE, false);
+        else if (op == OP_SUPPORT_CLAIM)
+            o.pushKV(T_INSUPPORTMAP, false);
+        o.pushKV(T_INQUEUE, false);
+    }
+    return true;
+}
+
 UniValue getclaimsfortx(const JSONRPCRequest& request)
 {
     rpc_help[GETCLAIMSFORTX].Check(request);
@@ -509,9 +615,6 @@ UniValue getclaimsfortx(const JSONRPCRequest& request)
     uint256 hash = ParseHashV(request.params[0], T_TXID " (parameter 1)");
     UniValue ret(UniValue::VARR);
 
-    int op;
-    std::vector<std::vector<unsigned char> > vvchParams;
-
     auto trieCache = ::ClaimtrieCache();
     CCoinsViewCache view(&::ChainstateActive().CoinsTip());
 
@@ -522,63 +625,71 @@ UniValue getclaimsfortx(const JSONRPCRequest& request)
     for (unsigned int i = 0; i < txouts.size(); ++i) {
         if (txouts[i].IsNull())
             continue;
-        vvchParams.clear();
-        const CTxOut& txout = txouts[i];
-        if (!DecodeClaimScript(txout.scriptPubKey, op, vvchParams))
-            continue;
         UniValue o(UniValue::VOBJ);
-        o.pushKV(T_N, static_cast<int64_t>(i));
-        std::string sName(vvchParams[0].begin(), vvchParams[0].end());
-        o.pushKV(T_NAME, escapeNonUtf8(sName));
-        if (op == OP_CLAIM_NAME) {
-            uint160 claimId = ClaimIdHash(hash, i);
-            o.pushKV(T_CLAIMID, claimId.GetHex());
-            o.pushKV(T_VALUE, HexStr(vvchParams[1].begin(), vvchParams[1].end()));
-        } else if (op == OP_UPDATE_CLAIM || op == OP_SUPPORT_CLAIM) {
-            uint160 claimId(vvchParams[1]);
-            o.pushKV(T_CLAIMID, claimId.GetHex());
-            if (vvchParams.size() > 2)
-                o.pushKV(T_VALUE, HexStr(vvchParams[2].begin(), vvchParams[2].end()));
+        if (claimOutputToJSON(trieCache, COutPoint(hash, i), txouts[i], nHeight, o))
+            PushBackMove(ret, std::move(o));
+    }
+    return ret;
+}
+
+UniValue getclaimsforaddress(const JSONRPCRequest& request)
+{
+    rpc_help[GETCLAIMSFORADDRESS].Check(request);
+
+    std::set<std::string> addresses;
+    for (auto& param : request.params[0].get_array().getValues()) {
+        // re-encoded so that it matches the address column of the coins database
+        auto dest = DecodeDestination(param.get_str());
+        if (!IsValidDestination(dest))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + param.get_str());
+        addresses.insert(EncodeDestination(dest));
+    }
+
+    LOCK(cs_main);
+    auto trieCache = ::ClaimtrieCache();
+    UniValue ret(UniValue::VARR);
+    auto pushOutput = [&](const std::string& address, const COutPoint& outPoint, const CTxOut& txout, int nHeight) {
+        UniValue o(UniValue::VOBJ);
+        o.pushKV(T_ADDRESS, address);
+        o.pushKV(T_TXID, outPoint.hash.GetHex());
+        o.pushKV(T_AMOUNT, txout.nValue);
+        if (claimOutputToJSON(trieCache, outPoint, txout, nHeight, o))
+            PushBackMove(ret, std::move(o));
+    };
+
+    // the address column is only as current as the last flush: rows spent since are still in it,
+    // and outputs created since are only in the coins cache
+    auto& coinsTip = ::ChainstateActive().CoinsTip();
+    std::set<COutPoint> seen;
+    for (auto& address : addresses) {
+        for (auto& coin : ::ChainstateActive().CoinsDB().GetCoinsForAddress(address)) {
+            if (!coinsTip.HaveCoin(coin.first))
+                continue;
+            seen.insert(coin.first);
+            const auto& current = coinsTip.AccessCoin(coin.first);
+            pushOutput(address, coin.first, current.out, current.nHeight);
         }
-        if (nHeight > 0) {
-            o.pushKV(T_DEPTH, ::ChainActive().Height() - nHeight);
-            if (op == OP_CLAIM_NAME || op == OP_UPDATE_CLAIM) {
-                bool inClaimTrie = trieCache.haveClaim(sName, COutPoint(hash, i));
-                o.pushKV(T_INCLAIMTRIE, inClaimTrie);
-                if (inClaimTrie) {
-                    CClaimValue claim;
-                    if (!trieCache.getInfoForName(sName, claim))
-                        LogPrintf("HaveClaim was true but getInfoForName returned false.");
-                    o.pushKV(T_ISCONTROLLING, (claim.outPoint.hash == hash && claim.outPoint.n == i));
-                } else {
-                    int nValidAtHeight;
-                    if (trieCache.haveClaimInQueue(sName, COutPoint(hash, i), nValidAtHeight)) {
-                        o.pushKV(T_INQUEUE, true);
-                        o.pushKV(T_BLOCKSTOVALID, nValidAtHeight - ::ChainActive().Height());
-                    } else
-                        o.pushKV(T_INQUEUE, false);
-                    }
-            } else if (op == OP_SUPPORT_CLAIM) {
-                bool inSupportMap = trieCache.haveSupport(sName, COutPoint(hash, i));
-                o.pushKV(T_INSUPPORTMAP, inSupportMap);
-                if (!inSupportMap) {
-                    int nValidAtHeight;
-                    if (trieCache.haveSupportInQueue(sName, COutPoint(hash, i), nValidAtHeight)) {
-                        o.pushKV(T_INQUEUE, true);
-                        o.pushKV(T_BLOCKSTOVALID, nValidAtHeight - ::ChainActive().Height());
-                    } else
-                        o.pushKV(T_INQUEUE, false);
-                }
-            }
-        } else {
-            o.pushKV(T_DEPTH, 0);
-            if (op == OP_CLAIM_NAME || op == OP_UPDATE_CLAIM)
-                o.pushKV(T_INCLAIMTRIE, false);
-            else if (op == OP_SUPPORT_CLAIM)
-                o.pushKV(T_INSUPPORTMAP, false);
-            o.pushKV(T_INQUEUE, false);
+    }
+    coinsTip.ForEachDirtyCoin([&](const COutPoint& outPoint, const Coin& coin) {
+        if (seen.count(outPoint))
+            return;
+        auto address = EncodeScriptDestination(coin.out.scriptPubKey);
+        if (!address.empty() && addresses.count(address))
+            pushOutput(address, outPoint, coin.out, coin.nHeight);
+    });
+
+    // pending ones only make it into the claim trie once mined
+    LOCK(::mempool.cs);
+    for (auto& entry : ::mempool.mapTx) {
+        auto& tx = entry.GetTx();
+        for (uint32_t i = 0; i < tx.vout.size(); ++i) {
+            COutPoint outPoint(tx.GetHash(), i);
+            if (::mempool.isSpent(outPoint))
+                continue;
+            auto address = EncodeScriptDestination(tx.vout[i].scriptPubKey);
+            if (!address.empty() && addresses.count(address))
+                pushOutput(address, outPoint, tx.vout[i], 0);
         }
-        ret.push_back(o);
     }
     return ret;
 }
@@ -851,6 +962,43 @@ UniValue checknormalization(const JSONRPCRequest& request)
     return trieCache.normalizeClaimName(name, force);
 }
 
+UniValue getclaimhistory(const JSONRPCRequest& request)
+{
+    rpc_help[GETCLAIMHISTORY].Check(request);
+
+    if (!g_claimindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Claim index is not enabled; start with -claimindex");
+
+    std::string claimId;
+    ParseClaimtrieId(request.params[0], claimId, T_CLAIMID " (parameter 1)");
+    if (claimId.length() != claimIdHexLength)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, T_CLAIMID " (parameter 1) should be a full 40-character claim id");
+
+    if (!g_claimindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Claims are still in the process of being indexed.");
+
+    std::vector<CClaimHistoryEntry> entries;
+    g_claimindex->FindClaimHistory(uint160S(claimId), entries);
+
+    UniValue ret(UniValue::VARR);
+    for (auto& entry : entries) {
+        UniValue o(UniValue::VOBJ);
+        o.pushKV(T_CLAIMTYPE, entry.op == OP_CLAIM_NAME ? "claim" : entry.op == OP_UPDATE_CLAIM ? "update" : "support");
+        o.pushKV(T_NAME, escapeNonUtf8(entry.name));
+        o.pushKV(T_TXID, entry.outPoint.hash.GetHex());
+        o.pushKV(T_N, (int)entry.outPoint.n);
+        o.pushKV(T_AMOUNT, entry.nAmount);
+        o.pushKV(T_HEIGHT, entry.nHeight);
+        if (entry.nSpentHeight >= 0) {
+            o.pushKV(T_SPENTTXID, entry.spentTxId.GetHex());
+            o.pushKV(T_SPENTHEIGHT, entry.nSpentHeight);
+            o.pushKV(T_ABANDONED, !entry.fUpdated);
+        }
+        ret.push_back(o);
+    }
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                            actor (function)            argNames
   //  --------------------- ------------------------        -----------------------     ----------
@@ -870,6 +1018,8 @@ static const CRPCCommand commands[] =
     { "Claimtrie",          "getclaimbyseq",                &getclaimbyseq,             { T_NAME,T_SEQUENCE,T_BLOCKHASH } },
     { "Claimtrie",          "getchangesinblock",            &getchangesinblock,         { T_BLOCKHASH } },
     { "Claimtrie",          "checknormalization",           &checknormalization,        { T_NAME } },
+    { "Claimtrie",          "getclaimhistory",              &getclaimhistory,           { T_CLAIMID } },
+    { "Claimtrie",          "getclaimsforaddress",          &getclaimsforaddress,       { T_ADDRESSES } },
 };
 
 void RegisterClaimTrieRPCCommands(CRPCTable &tableRPC)
@@ -52,6 +52,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getbalance", 2, "include_watchonly" },
     { "getbalance", 3, "avoid_reuse" },
     { "getblockhash", 0, "height" },
+    { "getaddresshistory", 1, "skip" },
+    { "getaddresshistory", 2, "count" },
+    { "getaddressbalance", 1, "height" },
+    { "getspentinfo", 1, "n" },
     { "waitforblockheight", 0, "height" },
     { "waitforblockheight", 1, "timeout" },
     { "waitforblock", 1, "timeout" },
@@ -179,6 +183,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getclaimproofbyseq", 1, "sequence"},
     { "supportclaim", 4, "isTip"},
     { "gettotalvalueofclaims", 0, "controlling_only"},
+    { "getclaimsforaddress", 0, "addresses"},
     { "stop", 0, "wait" },
 };
 // clang-format on
@@ -5,6 +5,7 @@
 #include <rpc/server.h>
 
 #include <banman.h>
+#include <blockencodings.h>
 #include <clientversion.h>
 #include <core_io.h>
 #include <net.h>
@@ -419,6 +420,67 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue getblockreconstructionstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getblockreconstructionstats",
+                "\nReturns statistics about blocks reconstructed from compact block announcements,\n"
+                "including the transactions that had to be requested from the announcing peer.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"blocks\": n,                        (numeric) Blocks reconstructed since startup\n"
+            "  \"blocks_with_requests\": n,          (numeric) How many of those needed a getblocktxn round trip\n"
+            "  \"requested_transactions\": n,        (numeric) Total transactions requested\n"
+            "  \"requested_claim_transactions\": n,  (numeric) Requested transactions carrying claims or supports\n"
+            "  \"recent\": [                         (array) The most recent reconstructions, oldest first\n"
+            "    {\n"
+            "      \"hash\": \"hash\",                  (string) The block hash\n"
+            "      \"time\": t,                        (numeric) UNIX time of the reconstruction\n"
+            "      \"transactions\": n,                (numeric) Transactions in the block\n"
+            "      \"prefilled\": n,                   (numeric) Transactions sent in the compact block\n"
+            "      \"mempool\": n,                     (numeric) Transactions found in our mempool or extra pool\n"
+            "      \"extra\": n,                       (numeric) Transactions found in the extra pool\n"
+            "      \"requested_claims\": n,            (numeric) Requested transactions carrying claims or supports\n"
+            "      \"requested\": [\"txid\",...]       (array) Transactions we had to request\n"
+            "    },...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockreconstructionstats", "")
+            + HelpExampleRpc("getblockreconstructionstats", "")
+                },
+            }.Check(request);
+
+    uint64_t blocks, blocks_with_requests, requested_txn, requested_claim_txn;
+    g_block_reconstruction_stats.GetTotals(blocks, blocks_with_requests, requested_txn, requested_claim_txn);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("blocks", blocks);
+    obj.pushKV("blocks_with_requests", blocks_with_requests);
+    obj.pushKV("requested_transactions", requested_txn);
+    obj.pushKV("requested_claim_transactions", requested_claim_txn);
+
+    UniValue recent(UniValue::VARR);
+    for (const auto& info : g_block_reconstruction_stats.GetRecent()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("hash", info.blockhash.GetHex());
+        entry.pushKV("time", info.nTime);
+        entry.pushKV("transactions", (uint64_t)info.tx_count);
+        entry.pushKV("prefilled", (uint64_t)info.prefilled_count);
+        entry.pushKV("mempool", (uint64_t)info.mempool_count);
+        entry.pushKV("extra", (uint64_t)info.extra_count);
+        entry.pushKV("requested_claims", (uint64_t)info.requested_claim_count);
+        UniValue requested(UniValue::VARR);
+        for (const auto& txid : info.requested)
+            requested.push_back(txid.GetHex());
+        entry.pushKV("requested", requested);
+        recent.push_back(entry);
+    }
+    obj.pushKV("recent", recent);
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -741,6 +803,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getblockreconstructionstats", &getblockreconstructionstats, {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
@@ -7,6 +7,7 @@
 
 #include <fs.h>
 #include <key_io.h>
+#include <rpc/cache.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
@@ -208,6 +209,14 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
             "   },...\n"
             "  ],\n"
             " \"logpath\": \"xxx\" (string) The complete file path to the debug log\n"
+            " \"cache\": {       (object) The cache of replies about blocks deep below the tip (see -rpccachesize)\n"
+            "    \"entries\"      (numeric) The number of replies cached\n"
+            "    \"usage\"        (numeric) Their estimated memory usage in bytes\n"
+            "    \"max_usage\"    (numeric) The limit on it, 0 when the cache is off\n"
+            "    \"min_depth\"    (numeric) How far below the tip a block has to be for replies about it to be cached\n"
+            "    \"hits\"         (numeric) The number of calls answered from the cache\n"
+            "    \"misses\"       (numeric) The number of calls that could have been but weren't\n"
+            " }\n"
             "}\n"
                 },
                 RPCExamples{
@@ -230,6 +239,7 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
     const std::string path = LogInstance().m_file_path.string();
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
+    result.pushKV("cache", g_rpc_result_cache.GetInfo());
 
     return result;
 }
@@ -358,13 +368,18 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+UniValue JSONRPCExecBatchObj(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
     UniValue ret(UniValue::VARR);
     for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
         ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
 
-    return ret.write() + "\n";
+    return ret;
+}
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+{
+    return JSONRPCExecBatchObj(jreq, vReq).write() + "\n";
 }
 
 /**
@@ -464,6 +479,18 @@ UniValue CRPCCaller::operator()(const JSONRPCRequest& jsonRequest)
     return val;
 }
 
+static bool ExecuteCachedCommand(const CRPCCommand& command, const JSONRPCRequest& request, UniValue& result, bool last_handler)
+{
+    std::string key;
+    if (g_rpc_result_cache.Lookup(request, key, result))
+        return true;
+    if (!command.actor(request, result, last_handler))
+        return false;
+    if (!key.empty())
+        g_rpc_result_cache.Insert(key, result);
+    return true;
+}
+
 static bool ExecuteCommand(const CRPCCommand& command, const JSONRPCRequest& request, UniValue& result, bool last_handler)
 {
     try
@@ -471,9 +498,9 @@ static bool ExecuteCommand(const CRPCCommand& command, const JSONRPCRequest& req
         RPCCommandExecution execution(request.strMethod);
         // Execute, convert arguments to array if necessary
         if (request.params.isObject()) {
-            return command.actor(transformNamedArguments(request, command.argNames), result, last_handler);
+            return ExecuteCachedCommand(command, transformNamedArguments(request, command.argNames), result, last_handler);
         } else {
-            return command.actor(request, result, last_handler);
+            return ExecuteCachedCommand(command, request, result, last_handler);
         }
     }
     catch (const std::exception& e)
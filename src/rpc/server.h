@@ -178,6 +178,7 @@ extern CRPCTable tableRPC;
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
+UniValue JSONRPCExecBatchObj(const JSONRPCRequest& jreq, const UniValue& vReq);
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
 
 // Retrieves any serialization flags requested in command line argument
@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <index/addressindex.h>
+#include <key_io.h>
+#include <test/claimtriefixture.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, RegTestingSetup)
+
+BOOST_AUTO_TEST_CASE(addressindex_history_and_balance_test)
+{
+    ClaimTrieChainFixture fixture;
+
+    // anyone can spend a P2SH of OP_TRUE, which still has an address
+    const CScript redeemScript = CScript() << OP_TRUE;
+    const CScript scriptPubKey = GetScriptForDestination(ScriptHash(redeemScript));
+    const std::string address = EncodeDestination(ScriptHash(redeemScript));
+
+    CMutableTransaction tx1 = BuildTransaction(fixture.GetCoinbase(), 0, 2);
+    tx1.vout[0].scriptPubKey = scriptPubKey;
+    tx1.vout[1].scriptPubKey = CScript() << OP_TRUE;
+    fixture.CommitTx(tx1);
+    fixture.IncrementBlocks(1);
+    const int height1 = ::ChainActive().Height();
+    const CAmount amount = tx1.vout[0].nValue;
+
+    // the index starts out behind and catches up in the background
+    AddressIndex addressindex(1 << 20, true);
+    addressindex.Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(50);
+    }
+
+    CMutableTransaction tx2 = BuildTransaction(tx1, 0, 1);
+    tx2.vin[0].scriptSig = CScript() << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+    tx2.vout[0].scriptPubKey = scriptPubKey;
+    fixture.CommitTx(tx2);
+    fixture.IncrementBlocks(1);
+    const int height2 = ::ChainActive().Height();
+
+    std::vector<CAddressHistoryEntry> entries;
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    addressindex.FindAddressHistory(address, 0, 10, entries);
+    BOOST_REQUIRE_EQUAL(entries.size(), 3U);
+
+    BOOST_CHECK_EQUAL(entries[0].txId, tx1.GetHash());
+    BOOST_CHECK_EQUAL(entries[0].nHeight, height1);
+    BOOST_CHECK_EQUAL(entries[0].nDelta, amount);
+
+    BOOST_CHECK_EQUAL(entries[1].txId, tx2.GetHash());
+    BOOST_CHECK_EQUAL(entries[1].nHeight, height2);
+    BOOST_CHECK(entries[1].outPoint == COutPoint(tx2.GetHash(), 0));
+    BOOST_CHECK_EQUAL(entries[1].nDelta, amount);
+
+    BOOST_CHECK_EQUAL(entries[2].txId, tx2.GetHash());
+    BOOST_CHECK_EQUAL(entries[2].nHeight, height2);
+    BOOST_CHECK(entries[2].outPoint == COutPoint(tx1.GetHash(), 0));
+    BOOST_CHECK_EQUAL(entries[2].nDelta, -amount);
+
+    addressindex.FindAddressHistory(address, 1, 1, entries);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outPoint == COutPoint(tx2.GetHash(), 0));
+
+    CAmount balance, received;
+    addressindex.GetAddressBalance(address, height1 - 1, balance, received);
+    BOOST_CHECK_EQUAL(balance, 0);
+    BOOST_CHECK_EQUAL(received, 0);
+    addressindex.GetAddressBalance(address, height1, balance, received);
+    BOOST_CHECK_EQUAL(balance, amount);
+    BOOST_CHECK_EQUAL(received, amount);
+    addressindex.GetAddressBalance(address, height2, balance, received);
+    BOOST_CHECK_EQUAL(balance, amount);
+    BOOST_CHECK_EQUAL(received, 2 * amount);
+
+    // a reorg rewinds the spend along with the new output
+    fixture.DecrementBlocks(1);
+    fixture.IncrementBlocks(1);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    addressindex.FindAddressHistory(address, 0, 10, entries);
+    BOOST_CHECK_EQUAL(entries.size(), 1U);
+    addressindex.GetAddressBalance(address, height2, balance, received);
+    BOOST_CHECK_EQUAL(balance, amount);
+    BOOST_CHECK_EQUAL(received, amount);
+
+    addressindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
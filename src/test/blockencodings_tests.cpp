@@ -325,6 +325,49 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(PrefilledIndexRoundTripTest)
+{
+    CTxMemPool pool;
+    CBlock block(BuildBlockTestCase());
+
+    // Send the last transaction in full, leaving only vtx[1] to be requested
+    CBlockHeaderAndShortTxIDs shortIDs(block, true, {2});
+    BOOST_CHECK_EQUAL(shortIDs.BlockTxCount(), block.vtx.size());
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << shortIDs;
+
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+    BOOST_CHECK( partialBlock.IsTxAvailable(0));
+    BOOST_CHECK(!partialBlock.IsTxAvailable(1));
+    BOOST_CHECK( partialBlock.IsTxAvailable(2));
+
+    uint64_t blocks, blocks_with_requests, requested_txn, requested_claim_txn;
+    g_block_reconstruction_stats.GetTotals(blocks, blocks_with_requests, requested_txn, requested_claim_txn);
+
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {block.vtx[1]}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+
+    uint64_t blocks2, blocks_with_requests2, requested_txn2, requested_claim_txn2;
+    g_block_reconstruction_stats.GetTotals(blocks2, blocks_with_requests2, requested_txn2, requested_claim_txn2);
+    BOOST_CHECK_EQUAL(blocks2, blocks + 1);
+    BOOST_CHECK_EQUAL(blocks_with_requests2, blocks_with_requests + 1);
+    BOOST_CHECK_EQUAL(requested_txn2, requested_txn + 1);
+    BOOST_CHECK_EQUAL(requested_claim_txn2, requested_claim_txn);
+
+    auto recent = g_block_reconstruction_stats.GetRecent();
+    BOOST_REQUIRE(!recent.empty());
+    BOOST_CHECK(recent.back().blockhash == block.GetHash());
+    BOOST_CHECK_EQUAL(recent.back().prefilled_count, 2U);
+    BOOST_REQUIRE_EQUAL(recent.back().requested.size(), 1U);
+    BOOST_CHECK(recent.back().requested[0] == block.vtx[1]->GetHash());
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
@@ -0,0 +1,89 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <index/claimindex.h>
+#include <test/claimtriefixture.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(claimindex_tests, RegTestingSetup)
+
+static const CClaimHistoryEntry& FindEntry(const std::vector<CClaimHistoryEntry>& entries, int op)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [op](const CClaimHistoryEntry& entry) {
+        return entry.op == op;
+    });
+    BOOST_REQUIRE(it != entries.end());
+    return *it;
+}
+
+BOOST_AUTO_TEST_CASE(claimindex_history_test)
+{
+    ClaimTrieChainFixture fixture;
+    CMutableTransaction tx1 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "one", 3);
+    fixture.IncrementBlocks(1);
+    const int claimHeight = ::ChainActive().Height();
+
+    // the index starts out behind and catches up in the background
+    ClaimIndex claimindex(1 << 20, true);
+    claimindex.Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!claimindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(50);
+    }
+
+    auto claimId = ClaimIdHash(tx1.GetHash(), 0);
+    CMutableTransaction s1 = fixture.MakeSupport(fixture.GetCoinbase(), tx1, "test", 1);
+    CMutableTransaction u1 = fixture.MakeUpdate(tx1, "test", "two", claimId, 2);
+    // doesn't spend the claim, so the trie ignores it, and so should the index
+    CMutableTransaction u2 = fixture.MakeUpdate(fixture.GetCoinbase(), "test", "three", claimId, 1);
+    fixture.IncrementBlocks(1);
+    fixture.Spend(u1);
+    fixture.IncrementBlocks(1);
+    const int abandonHeight = ::ChainActive().Height();
+
+    std::vector<CClaimHistoryEntry> entries;
+    BOOST_CHECK(claimindex.BlockUntilSyncedToCurrentChain());
+    BOOST_REQUIRE(claimindex.FindClaimHistory(claimId, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 3U);
+
+    BOOST_CHECK_EQUAL(entries[0].op, OP_CLAIM_NAME);
+    BOOST_CHECK_EQUAL(entries[0].nHeight, claimHeight);
+    BOOST_CHECK_EQUAL(entries[0].nAmount, 3);
+    BOOST_CHECK_EQUAL(entries[0].spentTxId, u1.GetHash());
+    BOOST_CHECK_EQUAL(entries[0].nSpentHeight, claimHeight + 1);
+    BOOST_CHECK(entries[0].fUpdated);
+
+    auto& update = FindEntry(entries, OP_UPDATE_CLAIM);
+    BOOST_CHECK_EQUAL(update.outPoint.hash, u1.GetHash());
+    BOOST_CHECK(std::none_of(entries.begin(), entries.end(), [&u2](const CClaimHistoryEntry& entry) {
+        return entry.outPoint.hash == u2.GetHash();
+    }));
+    BOOST_CHECK_EQUAL(update.nSpentHeight, abandonHeight);
+    BOOST_CHECK(!update.fUpdated);
+
+    auto& support = FindEntry(entries, OP_SUPPORT_CLAIM);
+    BOOST_CHECK_EQUAL(support.outPoint.hash, s1.GetHash());
+    BOOST_CHECK_EQUAL(support.name, "test");
+    BOOST_CHECK_EQUAL(support.nSpentHeight, -1);
+
+    // a reorg without the abandon rewinds it
+    fixture.DecrementBlocks(1);
+    fixture.IncrementBlocks(1);
+    BOOST_CHECK(claimindex.BlockUntilSyncedToCurrentChain());
+    BOOST_REQUIRE(claimindex.FindClaimHistory(claimId, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 3U);
+    BOOST_CHECK_EQUAL(FindEntry(entries, OP_UPDATE_CLAIM).nSpentHeight, -1);
+    BOOST_CHECK(FindEntry(entries, OP_UPDATE_CLAIM).spentTxId.IsNull());
+
+    BOOST_CHECK(!claimindex.FindClaimHistory(ClaimIdHash(s1.GetHash(), 0), entries));
+
+    claimindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://opensource.org/licenses/mit-license.php
 
 #include <test/claimtriefixture.h>
+#include <util/time.h>
 #include <validation.h>
 
 using namespace std;
@@ -512,6 +513,45 @@ BOOST_AUTO_TEST_CASE(claimtrie_update_takeover_test)
     BOOST_CHECK_EQUAL(height, takeover);
 }
 
+BOOST_AUTO_TEST_CASE(takeover_history_compaction_test)
+{
+    ClaimTrieChainFixture fixture;
+    fixture.setTakeoverHistoryWindow(3);
+    CMutableTransaction tx1 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "one", 1);
+    fixture.IncrementBlocks(1);
+    fixture.Spend(tx1);
+    fixture.IncrementBlocks(1);
+    CMutableTransaction tx2 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "two", 1);
+    fixture.IncrementBlocks(1);
+    int height = ::ChainActive().Height();
+    BOOST_CHECK(fixture.is_best_claim("test", tx2));
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test"), 3);
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test", true), 0);
+
+    // once tx2's takeover leaves the window the older ones get archived
+    fixture.IncrementBlocks(3);
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test"), 1);
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test", true), 2);
+    uint160 cid;
+    int takeover;
+    BOOST_REQUIRE(fixture.getLastTakeoverForName("test", cid, takeover));
+    BOOST_CHECK_EQUAL(cid, ClaimIdHash(tx2.GetHash(), 0));
+    BOOST_CHECK_EQUAL(takeover, height);
+    BOOST_CHECK(fixture.checkConsistency());
+
+    // undoing past the window brings the archived takeovers back
+    fixture.DecrementBlocks(4);
+    BOOST_CHECK(!fixture.getLastTakeoverForName("test", cid, takeover));
+    BOOST_CHECK_EQUAL(takeover, height - 1);
+    fixture.DecrementBlocks(1);
+    BOOST_REQUIRE(fixture.getLastTakeoverForName("test", cid, takeover));
+    BOOST_CHECK_EQUAL(cid, ClaimIdHash(tx1.GetHash(), 0));
+    BOOST_CHECK_EQUAL(takeover, height - 2);
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test"), 1);
+    BOOST_CHECK_EQUAL(fixture.takeoverCount("test", true), 0);
+    BOOST_CHECK(fixture.checkConsistency());
+}
+
 /*
     update
         update preserves claim id
@@ -522,6 +562,29 @@ BOOST_AUTO_TEST_CASE(claimtrie_update_takeover_test)
 
 
 */
+BOOST_AUTO_TEST_CASE(claimtrie_prefetch_test)
+{
+    ClaimTrieChainFixture fixture;
+    fixture.setPrefetchDepth(5);
+    CMutableTransaction tx1 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "one", 1);
+    fixture.IncrementBlocks(1);
+    CMutableTransaction tx2 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "two", 2);
+    fixture.IncrementBlocks(1);
+
+    // the background reader catches up with the heights ahead of the tip
+    int target = ::ChainActive().Height() + 1 + 5;
+    for (int i = 0; i < 500 && ::Claimtrie().prefetchedHeight() < target; ++i)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(::Claimtrie().prefetchedHeight(), target);
+
+    // and doesn't get in the way of connecting blocks
+    fixture.IncrementBlocks(5);
+    BOOST_CHECK(fixture.is_best_claim("test", tx2));
+    fixture.DecrementBlocks(5);
+    BOOST_CHECK(fixture.is_best_claim("test", tx1));
+    BOOST_CHECK(fixture.checkConsistency());
+}
+
 BOOST_AUTO_TEST_CASE(claimtrie_update_test)
 {
     //update preserves claim id
@@ -68,6 +68,10 @@ public:
     void processTakeovers() {
         insertTakeovers(true);
     }
+
+    const CClaimTrieStatements* statementsInUse() const {
+        return statements.get();
+    }
 };
 
 BOOST_FIXTURE_TEST_SUITE(claimtriecache_tests, RegTestingSetup)
@@ -343,6 +347,162 @@ BOOST_AUTO_TEST_CASE(trie_stays_consistent_test)
     BOOST_CHECK(trie.empty());
 }
 
+BOOST_AUTO_TEST_CASE(cache_statements_reuse_test)
+{
+    auto& trie = ::Claimtrie();
+    const CClaimTrieStatements* first;
+    uint256 hash;
+    {
+        CClaimTrieCacheTest cache(&trie);
+        BOOST_CHECK(cache.insertClaimIntoTrie("test", CClaimValue{}));
+        cache.incrementBlock();
+        hash = cache.getMerkleHash();
+        first = cache.statementsInUse();
+    }
+    {
+        // a cache made after the last one is gone gets its statements
+        CClaimTrieCacheTest cache(&trie);
+        BOOST_CHECK_EQUAL(cache.statementsInUse(), first);
+        CClaimTrieCacheTest other(&trie);
+        BOOST_CHECK(other.statementsInUse() != first);
+
+        BOOST_CHECK(cache.insertClaimIntoTrie("test", CClaimValue{}));
+        cache.incrementBlock();
+        BOOST_CHECK_EQUAL(cache.getMerkleHash(), hash);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(archive_as_of_height_test)
+{
+    auto dataDir = GetDataDir() / "archive_test";
+    fs::create_directories(dataDir);
+    CClaimTrie trie(10*1024*1024, true, 1, dataDir.string(), 1000, 1000, -1, 1000, 1000, 1000, 1000, 1,
+                    0, 0, 0, 0, 0, true);
+    CClaimTrieCache cache(&trie);
+
+    COutPoint op1(uint256S("1"), 0), op2(uint256S("2"), 0), opS(uint256S("3"), 0);
+    auto id1 = ClaimIdHash(op1.hash, op1.n), id2 = ClaimIdHash(op2.hash, op2.n);
+    BOOST_CHECK(cache.addClaim("test", op1, id1, 10, 1));
+    BOOST_CHECK(cache.incrementBlock()); // 1
+    BOOST_CHECK(cache.addClaim("test", op2, id2, 3, 2));
+    BOOST_CHECK(cache.addSupport("test", opS, id1, 5, 2));
+    BOOST_CHECK(cache.incrementBlock()); // 2
+    std::string nodeName;
+    int validHeight, originalHeight;
+    BOOST_CHECK(cache.removeClaim(id1, op1, nodeName, validHeight, originalHeight));
+    BOOST_CHECK(cache.incrementBlock()); // 3
+    BOOST_CHECK(cache.flush());
+
+    BOOST_CHECK(cache.isArchived(1));
+    BOOST_CHECK(!cache.isArchived(4));
+
+    auto at1 = cache.getClaimsForNameAt("test", 1);
+    BOOST_REQUIRE_EQUAL(at1.claimsNsupports.size(), 1U);
+    BOOST_CHECK_EQUAL(at1.claimsNsupports[0].claim.claimId, id1);
+    BOOST_CHECK_EQUAL(at1.claimsNsupports[0].effectiveAmount, 10);
+    BOOST_CHECK_EQUAL(at1.nLastTakeoverHeight, 1);
+
+    auto at2 = cache.getClaimsForNameAt("test", 2);
+    BOOST_REQUIRE_EQUAL(at2.claimsNsupports.size(), 2U);
+    BOOST_CHECK_EQUAL(at2.claimsNsupports[0].claim.claimId, id1);
+    BOOST_CHECK_EQUAL(at2.claimsNsupports[0].supports.size(), 1U);
+
+    // the spent claim is gone, and the same goes for the live rows at the tip
+    auto at3 = cache.getClaimsForNameAt("test", 3), tip = cache.getClaimsForName("test");
+    BOOST_REQUIRE_EQUAL(at3.claimsNsupports.size(), 1U);
+    BOOST_CHECK_EQUAL(at3.claimsNsupports[0].claim.claimId, id2);
+    BOOST_CHECK_EQUAL(at3.unmatchedSupports.size(), 1U);
+    BOOST_CHECK_EQUAL(tip.claimsNsupports.size(), 1U);
+    BOOST_CHECK_EQUAL(tip.nLastTakeoverHeight, at3.nLastTakeoverHeight);
+
+    // undoing the spend takes it back out of the archive
+    BOOST_CHECK(cache.decrementBlock());
+    BOOST_CHECK(cache.addClaim("test", op1, id1, 10, 1, validHeight, originalHeight));
+    BOOST_CHECK(cache.finalizeDecrement());
+    BOOST_CHECK_EQUAL(cache.getClaimsForNameAt("test", 2).claimsNsupports.size(), 2U);
+    BOOST_CHECK(!cache.isArchived(3));
+}
+
+BOOST_AUTO_TEST_CASE(page_size_change_test)
+{
+    auto file = (GetDataDir() / "page_size_test.sqlite").string();
+    sqlite::database db(file);
+    applyPragmas(db, 100);
+    db << "CREATE TABLE t (k INTEGER PRIMARY KEY, v BLOB)";
+    db << "BEGIN";
+    for (int i = 0; i < 1000; ++i)
+        db << "INSERT INTO t VALUES(?, ?)" << i << std::vector<unsigned char>(100, i);
+    db << "COMMIT";
+
+    BOOST_CHECK(!changePageSize(db, file, 1000)); // not a power of 2
+    BOOST_CHECK(changePageSize(db, file, 16384));
+    BOOST_CHECK(!changePageSize(db, file, 16384)); // already there
+    applyPragmas(db, 100, 1 << 20);
+
+    int pageSize = 0, rows = 0;
+    std::string journalMode;
+    db << "PRAGMA page_size" >> pageSize;
+    db << "PRAGMA journal_mode" >> journalMode;
+    db << "SELECT COUNT(*) FROM t" >> rows;
+    BOOST_CHECK_EQUAL(pageSize, 16384);
+    BOOST_CHECK_EQUAL(journalMode, "wal");
+    BOOST_CHECK_EQUAL(rows, 1000);
+    BOOST_CHECK(!fs::exists(file + ".vacuum"));
+}
+
+BOOST_AUTO_TEST_CASE(wal_checkpointer_test)
+{
+    auto file = (GetDataDir() / "checkpointer_test.sqlite").string();
+    sqlite::database db(file);
+    applyPragmas(db, 100);
+    db << "CREATE TABLE t (k INTEGER PRIMARY KEY, v BLOB)";
+    int filled = 0;
+    auto fill = [&db, &filled]() {
+        db << "BEGIN";
+        for (int i = filled; i < filled + 1000; ++i)
+            db << "INSERT INTO t VALUES(?, ?)" << i << std::vector<unsigned char>(100, i);
+        db << "COMMIT";
+        filled += 1000;
+    };
+    {
+        CWalCheckpointer checkpointer(db, file, 64 << 20);
+        fill();
+        BOOST_CHECK(checkpointer.sync());
+        BOOST_CHECK_GT(fs::file_size(file + "-wal"), 0U); // under budget: left for the writer to reuse
+    }
+    {
+        CWalCheckpointer checkpointer(db, file, 1); // every commit is over budget
+        // truncated right after a commit; the background PASSIVE may hold the checkpoint lock
+        // for a moment, so allow a few of them
+        auto fillUntilTruncated = [&]() {
+            fill();
+            for (int i = 0; i < 10 && fs::file_size(file + "-wal") > 0; ++i)
+                fill();
+            return fs::file_size(file + "-wal");
+        };
+        BOOST_CHECK_EQUAL(fillUntilTruncated(), 0U);
+        BOOST_CHECK(checkpointer.sync());
+
+        // a reader on an older snapshot holds up the truncation, but never the writer
+        sqlite::database open(file);
+        int rows = 0;
+        open << "BEGIN";
+        open << "SELECT COUNT(*) FROM t" >> rows;
+        BOOST_CHECK_EQUAL(rows, filled);
+        const auto start = GetTimeMillis();
+        BOOST_CHECK_NO_THROW(fill());
+        BOOST_CHECK_NO_THROW(fill());
+        BOOST_CHECK_LT(GetTimeMillis() - start, 1000);
+        BOOST_CHECK_GT(fs::file_size(file + "-wal"), 0U);
+        open << "COMMIT";
+        BOOST_CHECK_EQUAL(fillUntilTruncated(), 0U);
+    }
+    sqlite::database reader(file);
+    int rows = 0;
+    reader << "SELECT COUNT(*) FROM t" >> rows;
+    BOOST_CHECK_EQUAL(rows, filled);
+}
+
 BOOST_AUTO_TEST_CASE(verify_basic_serialization)
 {
     CClaimValue cv;
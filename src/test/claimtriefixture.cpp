@@ -76,7 +76,7 @@ BlockAssembler AssemblerForTest()
 
 ClaimTrieChainFixture::ClaimTrieChainFixture() : CClaimTrieCache(&::Claimtrie()),
     unique_block_counter(0), normalization_original(-1), expirationForkHeight(-1), forkhash_original(-1),
-    minRemovalWorkaroundHeight(-1), maxRemovalWorkaroundHeight(-1)
+    minRemovalWorkaroundHeight(-1), maxRemovalWorkaroundHeight(-1), takeoverHistoryWindow(-1), prefetchDepth(-1)
 {
     fRequireStandard = false;
     BOOST_CHECK_EQUAL(nNextHeight, ::ChainActive().Height() + 1);
@@ -122,6 +122,10 @@ ClaimTrieChainFixture::~ClaimTrieChainFixture()
         const_cast<int&>(base->nMinRemovalWorkaroundHeight) = minRemovalWorkaroundHeight;
         const_cast<int&>(base->nMaxRemovalWorkaroundHeight) = maxRemovalWorkaroundHeight;
     }
+    if (takeoverHistoryWindow >= 0)
+        const_cast<int&>(base->nTakeoverHistoryWindow) = takeoverHistoryWindow;
+    if (prefetchDepth >= 0)
+        const_cast<int&>(base->nPrefetchDepth) = prefetchDepth;
 }
 
 void ClaimTrieChainFixture::setRemovalWorkaroundHeight(int targetMinusCurrent, int blocks = 1000) {
@@ -137,6 +141,20 @@ void ClaimTrieChainFixture::setRemovalWorkaroundHeight(int targetMinusCurrent, i
     const_cast<int&>(base->nMaxRemovalWorkaroundHeight) = target + blocks;
 }
 
+void ClaimTrieChainFixture::setTakeoverHistoryWindow(int blocks)
+{
+    if (takeoverHistoryWindow < 0)
+        takeoverHistoryWindow = base->nTakeoverHistoryWindow;
+    const_cast<int&>(base->nTakeoverHistoryWindow) = blocks;
+}
+
+void ClaimTrieChainFixture::setPrefetchDepth(int blocks)
+{
+    if (prefetchDepth < 0)
+        prefetchDepth = base->nPrefetchDepth;
+    const_cast<int&>(base->nPrefetchDepth) = blocks;
+}
+
 void ClaimTrieChainFixture::setExpirationForkHeight(int targetMinusCurrent, int64_t preForkExpirationTime, int64_t postForkExpirationTime)
 {
     int target = ::ChainActive().Height() + targetMinusCurrent;
@@ -453,6 +471,13 @@ int64_t ClaimTrieChainFixture::nodeCount() const {
     return ret;
 }
 
+int64_t ClaimTrieChainFixture::takeoverCount(const std::string& name, bool archived) const {
+    int64_t ret = 0;
+    db << (archived ? "SELECT COUNT(*) FROM takeover_archive WHERE name = ?" : "SELECT COUNT(*) FROM takeover WHERE name = ?")
+       << name >> ret;
+    return ret;
+}
+
 std::vector<std::string> ClaimTrieChainFixture::getNodeChildren(const std::string &name)
 {
     std::vector<std::string> ret;
@@ -48,6 +48,8 @@ struct ClaimTrieChainFixture: public CClaimTrieCache
     int64_t extendedExpiration;
     int64_t forkhash_original;
     int minRemovalWorkaroundHeight, maxRemovalWorkaroundHeight;
+    int takeoverHistoryWindow;
+    int prefetchDepth;
 
     using CClaimTrieCache::getSupportsForName;
 
@@ -63,6 +65,10 @@ struct ClaimTrieChainFixture: public CClaimTrieCache
 
     void setRemovalWorkaroundHeight(int targetMinusCurrent, int blocks);
 
+    void setTakeoverHistoryWindow(int blocks);
+
+    void setPrefetchDepth(int blocks);
+
     bool CreateBlock(const std::unique_ptr<CBlockTemplate>& pblocktemplate);
 
     bool CreateCoinbases(unsigned int num_coinbases, std::vector<CTransaction>& coinbases);
@@ -108,6 +114,8 @@ struct ClaimTrieChainFixture: public CClaimTrieCache
 
     int64_t nodeCount() const;
 
+    int64_t takeoverCount(const std::string& name, bool archived = false) const;
+
     // is a claim in queue
     boost::test_tools::predicate_result is_claim_in_queue(const std::string& name, const CMutableTransaction &tx);
 
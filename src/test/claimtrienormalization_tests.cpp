@@ -51,6 +51,14 @@ BOOST_AUTO_TEST_CASE(normalization_only)
     // source: http://unicode.org/L2/L2009/09052-tr47.html
     BOOST_CHECK_EQUAL("\xE1\x84\x81\xE1\x85\xAA\xE1\x86\xB0",
                           ccache.normalizeClaimName("\xEA\xBD\x91", true));
+
+    // repeated names are answered from the cache
+    auto before = CClaimTrieCacheNormalizationFork::normalizationCacheStats();
+    BOOST_CHECK_EQUAL("test this", ccache.normalizeClaimName("Test This", true));
+    BOOST_CHECK_EQUAL("\xFF", ccache.normalizeClaimName("\xFF", true));
+    auto after = CClaimTrieCacheNormalizationFork::normalizationCacheStats();
+    BOOST_CHECK_EQUAL(after.hits, before.hits + 2);
+    BOOST_CHECK_EQUAL(after.misses, before.misses);
 }
 
 /*
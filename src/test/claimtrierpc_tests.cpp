@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://opensource.org/licenses/mit-license.php
 
+#include <key_io.h>
 #include <test/claimtriefixture.h>
 #include <util/strencodings.h>
 #include <validation.h>
@@ -406,4 +407,121 @@ BOOST_AUTO_TEST_CASE(claim_rpc_pending_amount_test)
     BOOST_CHECK(!claims[1].exists(T_PENDINGAMOUNT));
 }
 
+BOOST_AUTO_TEST_CASE(claim_rank_order_test)
+{
+    ClaimTrieChainFixture fixture;
+    std::string name = "rank";
+
+    // ties on amount and on height, broken by outpoint, plus supports that are and are not active yet
+    CMutableTransaction tx1 = BuildTransaction(fixture.GetCoinbase(), 0, 4);
+    for (uint32_t i = 0; i < tx1.vout.size(); ++i) {
+        tx1.vout[i].scriptPubKey = ClaimNameScript(name, std::to_string(i));
+        tx1.vout[i].nValue = 2;
+    }
+    fixture.CommitTx(tx1);
+    fixture.MakeClaim(fixture.GetCoinbase(), name, "later", 2);
+    fixture.IncrementBlocks(1);
+    fixture.MakeClaim(fixture.GetCoinbase(), name, "pending", 3);
+    fixture.MakeSupport(fixture.GetCoinbase(), tx1, name, 1);
+    fixture.IncrementBlocks(1);
+
+    auto getclaimsforname = tableRPC["getclaimsforname"];
+    auto getclaimbybid = tableRPC["getclaimbybid"];
+    auto getclaimbyseq = tableRPC["getclaimbyseq"];
+    JSONRPCRequest req;
+    req.params = UniValue(UniValue::VARR);
+    req.params.push_back(UniValue(name));
+    auto claims = getclaimsforname(req)[T_CLAIMS];
+    BOOST_REQUIRE_EQUAL(claims.size(), 6U);
+
+    for (int rank = 0; rank < 6; ++rank) {
+        req.params = UniValue(UniValue::VARR);
+        req.params.push_back(UniValue(name));
+        req.params.push_back(UniValue(rank));
+        auto byBid = getclaimbybid(req);
+        BOOST_CHECK_EQUAL(byBid[T_CLAIMID].get_str(), claims[rank][T_CLAIMID].get_str());
+        BOOST_CHECK_EQUAL(byBid[T_SEQUENCE].get_int(), claims[rank][T_SEQUENCE].get_int());
+        BOOST_CHECK_EQUAL(byBid[T_EFFECTIVEAMOUNT].get_int(), claims[rank][T_EFFECTIVEAMOUNT].get_int());
+        BOOST_CHECK_EQUAL(byBid[T_SUPPORTS].size(), claims[rank][T_SUPPORTS].size());
+        auto bySeq = getclaimbyseq(req);
+        BOOST_CHECK_EQUAL(bySeq[T_SEQUENCE].get_int(), rank);
+        BOOST_CHECK_EQUAL(claims[bySeq[T_BID].get_int()][T_CLAIMID].get_str(), bySeq[T_CLAIMID].get_str());
+    }
+
+    req.params = UniValue(UniValue::VARR);
+    req.params.push_back(UniValue(name));
+    req.params.push_back(UniValue(6));
+    BOOST_CHECK(getclaimbybid(req).empty());
+    BOOST_CHECK(getclaimbyseq(req).empty());
+}
+
+BOOST_AUTO_TEST_CASE(getclaimsforaddress_test)
+{
+    ClaimTrieChainFixture fixture;
+
+    // anyone can spend a P2SH of OP_TRUE, which still has an address
+    const CScript redeemScript = CScript() << OP_TRUE;
+    const CScript scriptPubKey = GetScriptForDestination(ScriptHash(redeemScript));
+    const std::string address = EncodeDestination(ScriptHash(redeemScript));
+
+    CMutableTransaction tx1 = BuildTransaction(fixture.GetCoinbase(), 0, 2);
+    tx1.vout[0].scriptPubKey = ClaimNameScript("test", "one", false) + scriptPubKey;
+    tx1.vout[1].scriptPubKey = CScript() << OP_TRUE;
+    fixture.CommitTx(tx1);
+    fixture.MakeClaim(fixture.GetCoinbase(), "other", "two", 1);
+    fixture.IncrementBlocks(1);
+
+    CMutableTransaction tx2 = BuildTransaction(fixture.GetCoinbase(), 0, 1);
+    tx2.vout[0].scriptPubKey = SupportClaimScript("test", ClaimIdHash(tx1.GetHash(), 0), "", false) + scriptPubKey;
+    fixture.CommitTx(tx2);
+
+    auto getclaimsforaddress = tableRPC["getclaimsforaddress"];
+    JSONRPCRequest req;
+    UniValue addresses(UniValue::VARR);
+    addresses.push_back(address);
+    req.params = UniValue(UniValue::VARR);
+    req.params.push_back(addresses);
+
+    auto results = getclaimsforaddress(req);
+    BOOST_REQUIRE_EQUAL(results.size(), 2U);
+    BOOST_CHECK_EQUAL(results[0][T_TXID].get_str(), tx1.GetHash().GetHex());
+    BOOST_CHECK_EQUAL(results[0][T_ADDRESS].get_str(), address);
+    BOOST_CHECK_EQUAL(results[0][T_NAME].get_str(), "test");
+    BOOST_CHECK(results[0][T_INCLAIMTRIE].get_bool());
+    BOOST_CHECK_EQUAL(results[1][T_TXID].get_str(), tx2.GetHash().GetHex());
+    BOOST_CHECK_EQUAL(results[1][T_CLAIMID].get_str(), ClaimIdHash(tx1.GetHash(), 0).GetHex());
+    BOOST_CHECK_EQUAL(results[1][T_DEPTH].get_int(), 0);
+    BOOST_CHECK(!results[1][T_INSUPPORTMAP].get_bool());
+
+    fixture.IncrementBlocks(1);
+    results = getclaimsforaddress(req);
+    BOOST_REQUIRE_EQUAL(results.size(), 2U);
+    for (auto& result : results.getValues())
+        BOOST_CHECK_EQUAL(result[T_DEPTH].get_int(), result[T_TXID].get_str() == tx1.GetHash().GetHex() ? 1 : 0);
+
+    // spent since the last flush, so still in the address column of the database but not in the coins cache
+    ::ChainstateActive().ForceFlushStateToDisk();
+    const CScript redeem = CScript() << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+    CMutableTransaction tx3 = BuildTransaction(tx1, 0, 1);
+    tx3.vin[0].scriptSig = redeem;
+    tx3.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    fixture.CommitTx(tx3);
+    fixture.IncrementBlocks(1);
+    results = getclaimsforaddress(req);
+    BOOST_REQUIRE_EQUAL(results.size(), 1U);
+    BOOST_CHECK_EQUAL(results[0][T_TXID].get_str(), tx2.GetHash().GetHex());
+
+    // a pending output already spent by another pending transaction
+    CMutableTransaction tx4 = BuildTransaction(tx3, 0, 1);
+    tx4.vout[0].scriptPubKey = SupportClaimScript("test", ClaimIdHash(tx1.GetHash(), 0), "", false) + scriptPubKey;
+    fixture.CommitTx(tx4);
+    CMutableTransaction tx5 = BuildTransaction(tx4, 0, 1);
+    tx5.vin[0].scriptSig = redeem;
+    tx5.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    fixture.CommitTx(tx5);
+    results = getclaimsforaddress(req);
+    BOOST_REQUIRE_EQUAL(results.size(), 1U);
+    BOOST_CHECK_EQUAL(results[0][T_TXID].get_str(), tx2.GetHash().GetHex());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -751,4 +751,47 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 6ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolUpdateFromBlockTest)
+{
+    // [tx1].0 <- [tx2].0 <- [tx4].0 <- [tx5]
+    // [tx1].1 <- [tx3].0 <- [tx4]
+    // with tx1 and tx2 coming back from a disconnected block after the others are in the pool
+    auto tx1 = make_tx(/* output_values */ {5 * COIN, 5 * COIN});
+    auto tx2 = make_tx(/* output_values */ {4 * COIN}, /* inputs */ {tx1});
+    auto tx3 = make_tx(/* output_values */ {4 * COIN}, /* inputs */ {tx1}, /* input_indices */ {1});
+    auto tx4 = make_tx(/* output_values */ {7 * COIN}, /* inputs */ {tx2, tx3});
+    auto tx5 = make_tx(/* output_values */ {6 * COIN}, /* inputs */ {tx4});
+    const std::vector<CMutableTransaction> txs{tx1, tx2, tx3, tx4, tx5};
+
+    TestMemPoolEntryHelper entry;
+    CTxMemPool expected, pool;
+    LOCK2(cs_main, expected.cs);
+    LOCK(pool.cs);
+    for (size_t i = 0; i < txs.size(); ++i) {
+        expected.addUnchecked(entry.Fee(1000LL * (i + 1)).FromTx(txs[i]));
+    }
+    for (size_t i : {2, 3, 4, 0, 1}) {
+        pool.addUnchecked(entry.Fee(1000LL * (i + 1)).FromTx(txs[i]));
+    }
+    pool.UpdateTransactionsFromBlock({tx1.GetHash(), tx2.GetHash()});
+
+    for (const auto& tx : txs) {
+        const auto& want = *expected.mapTx.find(tx.GetHash());
+        const auto& got = *pool.mapTx.find(tx.GetHash());
+        BOOST_CHECK_EQUAL(got.GetCountWithAncestors(), want.GetCountWithAncestors());
+        BOOST_CHECK_EQUAL(got.GetSizeWithAncestors(), want.GetSizeWithAncestors());
+        BOOST_CHECK_EQUAL(got.GetModFeesWithAncestors(), want.GetModFeesWithAncestors());
+        BOOST_CHECK_EQUAL(got.GetCountWithDescendants(), want.GetCountWithDescendants());
+        BOOST_CHECK_EQUAL(got.GetSizeWithDescendants(), want.GetSizeWithDescendants());
+        BOOST_CHECK_EQUAL(got.GetModFeesWithDescendants(), want.GetModFeesWithDescendants());
+    }
+    size_t ancestors, descendants;
+    pool.GetTransactionAncestry(tx1.GetHash(), ancestors, descendants);
+    BOOST_CHECK_EQUAL(ancestors, 1ULL);
+    BOOST_CHECK_EQUAL(descendants, 5ULL);
+    pool.GetTransactionAncestry(tx5.GetHash(), ancestors, descendants);
+    BOOST_CHECK_EQUAL(ancestors, 5ULL);
+    BOOST_CHECK_EQUAL(descendants, 5ULL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
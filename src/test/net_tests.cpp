@@ -11,6 +11,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <net.h>
+#include <net_processing.h>
 #include <netbase.h>
 #include <chainparams.h>
 #include <util/memory.h>
@@ -304,4 +305,65 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
 }
 
 
+BOOST_AUTO_TEST_CASE(recent_block_cache)
+{
+    CMutableTransaction plain;
+    plain.vin.resize(1);
+    plain.vin[0].scriptSig = CScript() << OP_1;
+    plain.vout.resize(1);
+    plain.vout[0].nValue = COIN;
+    CMutableTransaction segwit = plain;
+    segwit.vin[0].scriptWitness.stack.push_back({1, 2, 3});
+
+    CBlock without_witness, with_witness;
+    without_witness.vtx.push_back(MakeTransactionRef(plain));
+    with_witness.nNonce = 1;
+    with_witness.vtx.push_back(MakeTransactionRef(plain));
+    with_witness.vtx.push_back(MakeTransactionRef(segwit));
+
+    auto serialize = [](const CBlock& block, int flags) {
+        std::vector<uint8_t> data;
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | flags, data, 0, block);
+        return data;
+    };
+
+    RecentBlockCache cache(1 << 20);
+    BOOST_CHECK(!cache.Get(without_witness.GetHash(), true));
+    cache.Add(without_witness);
+    cache.Add(with_witness);
+
+    // both encodings are kept, and shared when they're the same
+    auto data = cache.Get(without_witness.GetHash(), true);
+    BOOST_REQUIRE(data);
+    BOOST_CHECK(*data == serialize(without_witness, 0));
+    BOOST_CHECK(cache.Get(without_witness.GetHash(), false) == data);
+    data = cache.Get(with_witness.GetHash(), true);
+    BOOST_REQUIRE(data);
+    BOOST_CHECK(*data == serialize(with_witness, 0));
+    data = cache.Get(with_witness.GetHash(), false);
+    BOOST_REQUIRE(data);
+    BOOST_CHECK(*data == serialize(with_witness, SERIALIZE_TRANSACTION_NO_WITNESS));
+    const size_t without_witness_usage = serialize(without_witness, 0).size();
+    const size_t with_witness_usage = serialize(with_witness, 0).size() + serialize(with_witness, SERIALIZE_TRANSACTION_NO_WITNESS).size();
+    BOOST_CHECK_EQUAL(cache.Usage(), without_witness_usage + with_witness_usage);
+
+    // the least recently served block goes first
+    cache.Get(without_witness.GetHash(), false);
+    cache.SetMaxUsage(without_witness_usage);
+    BOOST_CHECK(cache.Get(without_witness.GetHash(), true));
+    BOOST_CHECK(!cache.Get(with_witness.GetHash(), true));
+    cache.Add(with_witness);
+    BOOST_CHECK(!cache.Get(with_witness.GetHash(), true));
+
+    cache.SetMaxUsage(with_witness_usage);
+    cache.Add(with_witness);
+    BOOST_CHECK(!cache.Get(without_witness.GetHash(), true));
+    BOOST_CHECK(cache.Get(with_witness.GetHash(), true));
+
+    cache.SetMaxUsage(0);
+    BOOST_CHECK_EQUAL(cache.Usage(), 0U);
+    cache.Add(without_witness);
+    BOOST_CHECK(!cache.Get(without_witness.GetHash(), true));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,13 +3,18 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <rpc/server.h>
+#include <rpc/cache.h>
+#include <rpc/cbor.h>
 #include <rpc/client.h>
+#include <rpc/protocol.h>
 #include <rpc/util.h>
 
 #include <core_io.h>
 #include <init.h>
 #include <interfaces/chain.h>
+#include <primitives/block.h>
 #include <test/setup_common.h>
+#include <univalue_builder.h>
 #include <util/strencodings.h>
 #include <util/time.h>
 
@@ -234,6 +239,134 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+static std::string CBORHex(const UniValue& value, bool hex = false)
+{
+    auto cbor = EncodeCBOR(value, hex);
+    return HexStr(cbor.begin(), cbor.end());
+}
+
+static UniValue CBORFromHex(const std::string& hex)
+{
+    auto data = ParseHex(hex);
+    UniValue value;
+    BOOST_REQUIRE(DecodeCBOR(std::string(data.begin(), data.end()), value));
+    return value;
+}
+
+static bool CBORFails(const std::string& hex)
+{
+    auto data = ParseHex(hex);
+    UniValue value;
+    return !DecodeCBOR(std::string(data.begin(), data.end()), value);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cbor)
+{
+    BOOST_CHECK_EQUAL(CBORHex(NullUniValue), "f6");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue(false)), "f4");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue(100)), "1864");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue(-1000)), "3903e7");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue("a")), "6161");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue("")), "60");
+    // hex goes over as bytes where it's known to be hex, amounts as decimal fractions
+    BOOST_CHECK_EQUAL(CBORHex(UniValue("00ff")), "6430306666");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue("00ff"), true), "4200ff");
+    BOOST_CHECK_EQUAL(CBORHex(UniValue("00FF"), true), "6430304646");
+    BOOST_CHECK_EQUAL(CBORHex(ValueFromAmount(150000000)), "c482271a08f0d180");
+    BOOST_CHECK_EQUAL(CBORHex(ValueFromAmount(-5)), "c4822724");
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hash", uint256S("0xabcdef").GetHex());
+    obj.pushKV("name", "cafe");
+    obj.pushKV("amount", ValueFromAmount(123456789));
+    obj.pushKV("height", 1000000);
+    obj.pushKV("big", UniValue(std::numeric_limits<uint64_t>::max()));
+    obj.pushKV("fee", ValueFromAmount(1));
+    obj.pushKV("ratio", 0.25);
+    UniValue arr(UniValue::VARR);
+    arr.push_back(true);
+    arr.push_back(NullUniValue);
+    arr.push_back("text");
+    obj.pushKV("list", arr);
+    BOOST_CHECK_EQUAL(EncodeCBOR(find_value(obj, "hash"), true).size(), 2U + 32U);
+    BOOST_CHECK(EncodeCBOR(obj).size() < obj.write().size());
+    BOOST_CHECK_EQUAL(CBORFromHex(CBORHex(obj)).write(), obj.write());
+    // by key: a name is text even when it reads as hex
+    UniValue keyed(UniValue::VOBJ);
+    keyed.pushKV("txid", "cafe");
+    keyed.pushKV("name", "cafe");
+    BOOST_CHECK_EQUAL(CBORHex(keyed), "a2647478696442cafe646e616d656463616665");
+
+    // other encoders' choices decode too
+    BOOST_CHECK_EQUAL(CBORFromHex("f93c00").get_real(), 1.0);
+    BOOST_CHECK_EQUAL(CBORFromHex("fa47c35000").get_real(), 100000.0);
+    BOOST_CHECK_EQUAL(CBORFromHex("1b000000e8d4a51000").get_int64(), 1000000000000);
+    BOOST_CHECK_EQUAL(CBORFromHex("a16161820102").write(), "{\"a\":[1,2]}");
+
+    BOOST_CHECK(CBORFails(""));
+    BOOST_CHECK(CBORFails("1864ff")); // trailing data
+    BOOST_CHECK(CBORFails("19ff")); // truncated
+    BOOST_CHECK(CBORFails("62ff")); // truncated
+    BOOST_CHECK(CBORFails("9f01ff")); // indefinite length
+    BOOST_CHECK(CBORFails("a10102")); // non-text key
+    BOOST_CHECK(CBORFails("fb7ff8000000000000")); // NaN
+    BOOST_CHECK(CBORFails("c10102")); // unknown tag
+    BOOST_CHECK(CBORFails("9bffffffffffffffff")); // absurd length
+}
+
+BOOST_AUTO_TEST_CASE(rpc_univalue_builder)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("a", 1);
+    UniValue array(UniValue::VARR);
+    UniValueReserve(array, 2);
+    PushBackMove(array, std::move(inner));
+    PushBackMove(array, UniValue("text"));
+    BOOST_CHECK_EQUAL(array.write(), "[{\"a\":1},\"text\"]");
+
+    UniValue object(UniValue::VOBJ);
+    UniValueReserve(object, 3);
+    object.pushKV("k", 1);
+    PushKVMove(object, "k", std::move(array)); // replaces, as pushKV does
+    PushKVMoveUnique(object, "u", UniValue(2));
+    BOOST_CHECK_EQUAL(object.write(), "{\"k\":[{\"a\":1},\"text\"],\"u\":2}");
+
+    // nothing to add to but arrays and objects, as with push_back and pushKV
+    UniValue str("s");
+    PushBackMove(str, UniValue(1));
+    PushKVMove(str, "k", UniValue(1));
+    PushKVMoveUnique(str, "k", UniValue(1));
+    BOOST_CHECK_EQUAL(str.write(), "\"s\"");
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cbor_reply)
+{
+    // a hash returned as the whole result goes over as a 32 byte string
+    const auto hash = CallRPC("getblockhash 0").get_str();
+    UniValue request(UniValue::VOBJ);
+    request.pushKV("method", "getblockhash");
+    request.pushKV("id", 1);
+    const auto reply = JSONRPCReplyObj(hash, NullUniValue, 1);
+    const auto cbor = EncodeCBORReply(reply, request);
+    BOOST_CHECK(HexStr(cbor).find("66726573756c74" "5820" + hash) != std::string::npos); // "result": h'...'
+    BOOST_CHECK_EQUAL(CBORFromHex(HexStr(cbor)).write(), reply.write());
+
+    // each reply of a batch by its own method, and text for the ones that aren't known to be hex
+    UniValue echo(UniValue::VOBJ);
+    echo.pushKV("method", "echo");
+    echo.pushKV("id", 2);
+    UniValue requests(UniValue::VARR);
+    requests.push_back(request);
+    requests.push_back(echo);
+    UniValue replies(UniValue::VARR);
+    replies.push_back(reply);
+    replies.push_back(JSONRPCReplyObj("cafe", NullUniValue, 2));
+    const auto batch = HexStr(EncodeCBORReply(replies, requests));
+    BOOST_CHECK(batch.find("66726573756c74" "5820" + hash) != std::string::npos);
+    BOOST_CHECK(batch.find("66726573756c74" "6463616665") != std::string::npos); // "result": "cafe"
+    BOOST_CHECK_EQUAL(HexStr(EncodeCBOR(reply)).find("5820"), std::string::npos);
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
@@ -436,4 +569,53 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(rpc_result_cache, TestChain100Setup)
+{
+    g_rpc_result_cache.Configure(1 << 20, 10);
+    const std::string deep = CallRPC("getblockhash 5").get_str();
+    const std::string shallow = CallRPC("getblockhash 95").get_str();
+
+    UniValue first = CallRPC("getblock " + deep);
+    UniValue info = g_rpc_result_cache.GetInfo();
+    BOOST_CHECK_EQUAL(info["entries"].get_int(), 1);
+    BOOST_CHECK_EQUAL(info["misses"].get_int(), 1);
+    BOOST_CHECK_EQUAL(info["hits"].get_int(), 0);
+
+    // the same call with the hash in uppercase is a hit
+    UniValue second = CallRPC("getblock " + boost::to_upper_copy(deep));
+    BOOST_CHECK_EQUAL(second.write(), first.write());
+    BOOST_CHECK_EQUAL(g_rpc_result_cache.GetInfo()["hits"].get_int(), 1);
+
+    // blocks near the tip are left out
+    CallRPC("getblock " + shallow);
+    CallRPC("getblock " + shallow);
+    info = g_rpc_result_cache.GetInfo();
+    BOOST_CHECK_EQUAL(info["entries"].get_int(), 1);
+    BOOST_CHECK_EQUAL(info["misses"].get_int(), 1);
+    BOOST_CHECK_EQUAL(info["hits"].get_int(), 1);
+
+    // confirmations follow the tip
+    CreateAndProcessBlock({}, CScript() << OP_TRUE);
+    UniValue third = CallRPC("getblock " + deep);
+    BOOST_CHECK_EQUAL(third["confirmations"].get_int(), first["confirmations"].get_int() + 1);
+    BOOST_CHECK_EQUAL(third["hash"].get_str(), deep);
+    BOOST_CHECK_EQUAL(g_rpc_result_cache.GetInfo()["hits"].get_int(), 2);
+
+    // other params make another entry
+    UniValue hex = CallRPC("getblockheader " + deep + " false");
+    BOOST_CHECK_EQUAL(CallRPC("getblockheader " + deep + " false").get_str(), hex.get_str());
+    info = g_rpc_result_cache.GetInfo();
+    BOOST_CHECK_EQUAL(info["entries"].get_int(), 2);
+    BOOST_CHECK_EQUAL(info["hits"].get_int(), 3);
+
+    // reorgs clear it
+    CallRPC("invalidateblock " + CallRPC("getblockhash 90").get_str());
+    BOOST_CHECK_EQUAL(g_rpc_result_cache.GetInfo()["entries"].get_int(), 0);
+
+    // and turned off, it keeps nothing
+    g_rpc_result_cache.Configure(0, DEFAULT_RPC_CACHE_DEPTH);
+    CallRPC("getblock " + deep);
+    BOOST_CHECK_EQUAL(g_rpc_result_cache.GetInfo()["entries"].get_int(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
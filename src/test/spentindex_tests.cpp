@@ -0,0 +1,53 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php
+
+#include <index/spentindex.h>
+#include <test/claimtriefixture.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spentindex_tests, RegTestingSetup)
+
+BOOST_AUTO_TEST_CASE(spentindex_find_spend_test)
+{
+    ClaimTrieChainFixture fixture;
+    CMutableTransaction tx1 = fixture.MakeClaim(fixture.GetCoinbase(), "test", "one", 3);
+    fixture.IncrementBlocks(1);
+
+    // the index starts out behind and catches up in the background
+    SpentIndex spentindex(1 << 20, true);
+    spentindex.Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!spentindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(50);
+    }
+
+    CSpentIndexValue value;
+    BOOST_CHECK(spentindex.FindSpend(tx1.vin[0].prevout, value));
+    BOOST_CHECK_EQUAL(value.txId, tx1.GetHash());
+    BOOST_CHECK_EQUAL(value.nIn, 0U);
+    BOOST_CHECK_EQUAL(value.nHeight, ::ChainActive().Height());
+    BOOST_CHECK(!spentindex.FindSpend(COutPoint(tx1.GetHash(), 0), value));
+
+    CMutableTransaction u1 = fixture.MakeUpdate(tx1, "test", "two", ClaimIdHash(tx1.GetHash(), 0), 3);
+    fixture.IncrementBlocks(1);
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.FindSpend(COutPoint(tx1.GetHash(), 0), value));
+    BOOST_CHECK_EQUAL(value.txId, u1.GetHash());
+    BOOST_CHECK_EQUAL(value.nHeight, ::ChainActive().Height());
+
+    // a reorg without the update rewinds it
+    fixture.DecrementBlocks(1);
+    fixture.IncrementBlocks(1);
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(!spentindex.FindSpend(COutPoint(tx1.GetHash(), 0), value));
+
+    spentindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -373,4 +373,61 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(mempool_parallel_script_checks, TestChain100Setup)
+{
+    // Transactions with several inputs have their scripts checked by the
+    // script check threads on the way into the mempool; failures still have
+    // to be told apart as they are inline.
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction fund;
+    fund.nVersion = 1;
+    fund.vin.resize(1);
+    fund.vin[0].prevout = COutPoint(m_coinbase_txns[0].GetHash(), 0);
+    for (int i = 0; i < 4; i++)
+        fund.vout.emplace_back(11*CENT, scriptPubKey);
+    {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, fund, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        fund.vin[0].scriptSig << vchSig;
+    }
+    CreateAndProcessBlock({fund}, scriptPubKey);
+
+    auto make_spend = [&](unsigned int bad_input, bool non_der) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        for (uint32_t i = 0; i < fund.vout.size(); i++)
+            spend.vin.emplace_back(COutPoint(fund.GetHash(), i));
+        spend.vout.emplace_back(40*CENT, scriptPubKey);
+        for (unsigned int i = 0; i < spend.vin.size(); i++) {
+            std::vector<unsigned char> vchSig;
+            // sign input 0's hash for the bad input, unless only its encoding is to be wrong
+            uint256 hash = SignatureHash(scriptPubKey, spend, i == bad_input && !non_der ? 0 : i, SIGHASH_ALL, 0, SigVersion::BASE);
+            BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+            if (i == bad_input && non_der)
+                vchSig.push_back((unsigned char)0); // padding byte makes this non-DER
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+            spend.vin[i].scriptSig << vchSig;
+        }
+        return MakeTransactionRef(spend);
+    };
+
+    LOCK(cs_main);
+    CValidationState state;
+    BOOST_CHECK(!AcceptToMemoryPool(mempool, state, make_spend(2, false), nullptr, nullptr, true, 0));
+    BOOST_CHECK(state.GetReason() == ValidationInvalidReason::CONSENSUS);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mandatory-script-verify-flag-failed (Signature must be zero for failed CHECK(MULTI)SIG operation)");
+
+    state = CValidationState();
+    BOOST_CHECK(!AcceptToMemoryPool(mempool, state, make_spend(3, true), nullptr, nullptr, true, 0));
+    BOOST_CHECK(state.GetReason() == ValidationInvalidReason::TX_NOT_STANDARD);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "non-mandatory-script-verify-flag (Non-canonical DER signature)");
+
+    state = CValidationState();
+    BOOST_CHECK(AcceptToMemoryPool(mempool, state, make_spend(fund.vout.size(), false), nullptr, nullptr, true, 0));
+    BOOST_CHECK_EQUAL(mempool.size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
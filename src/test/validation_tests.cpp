@@ -4,6 +4,7 @@
 
 #include <chainparams.h>
 #include <net.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <test/setup_common.h>
@@ -92,4 +93,60 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_FIXTURE_TEST_CASE(block_index_snapshot_test, TestChain100Setup)
+{
+    std::map<uint256, std::unique_ptr<CBlockIndex>> loaded;
+    auto insertBlockIndex = [&loaded](const uint256& hash) {
+        auto& pindex = loaded[hash];
+        if (!pindex)
+            pindex = MakeUnique<CBlockIndex>(hash);
+        return pindex.get();
+    };
+    std::vector<CBlockIndex*> sortedByHeight;
+
+    ::ChainstateActive().ForceFlushStateToDisk();
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(WriteBlockIndexSnapshot());
+        BOOST_CHECK(pblocktree->LoadBlockIndexSnapshot(insertBlockIndex, sortedByHeight));
+        BOOST_CHECK_EQUAL(sortedByHeight.size(), ::BlockIndex().size());
+        for (std::size_t i = 0; i < sortedByHeight.size(); ++i) {
+            const auto pindex = sortedByHeight[i];
+            const auto expected = LookupBlockIndex(pindex->hash);
+            BOOST_REQUIRE(expected);
+            BOOST_CHECK(i == 0 || sortedByHeight[i - 1]->nHeight <= pindex->nHeight);
+            BOOST_CHECK_EQUAL(pindex->nHeight, expected->nHeight);
+            BOOST_CHECK_EQUAL(pindex->pprev ? pindex->pprev->hash : uint256(), expected->pprev ? expected->pprev->hash : uint256());
+            BOOST_CHECK_EQUAL(pindex->nStatus, expected->nStatus);
+            BOOST_CHECK_EQUAL(pindex->nTx, expected->nTx);
+            BOOST_CHECK_EQUAL(pindex->nDataPos, expected->nDataPos);
+            BOOST_CHECK_EQUAL(pindex->hashClaimTrie, expected->hashClaimTrie);
+            BOOST_CHECK_EQUAL(pindex->nBits, expected->nBits);
+        }
+
+        // a corrupt entry count, just past the version, is caught before anything is allocated for it
+        FILE* file = fsbridge::fopen(GetDataDir() / "block_index.snapshot", "r+b");
+        BOOST_REQUIRE(file);
+        const uint32_t count = std::numeric_limits<uint32_t>::max();
+        BOOST_CHECK_EQUAL(fseek(file, sizeof(uint32_t), SEEK_SET), 0);
+        BOOST_CHECK_EQUAL(fwrite(&count, sizeof(count), 1, file), 1U);
+        fclose(file);
+        sortedByHeight.clear();
+        BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(insertBlockIndex, sortedByHeight));
+        BOOST_CHECK(sortedByHeight.empty());
+    }
+
+    // nothing is written while the database lags behind, and a new block makes the snapshot stale
+    CreateAndProcessBlock({}, CScript() << OP_TRUE);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(!WriteBlockIndexSnapshot());
+    }
+    ::ChainstateActive().ForceFlushStateToDisk();
+    sortedByHeight.clear();
+    BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(insertBlockIndex, sortedByHeight));
+    BOOST_CHECK(sortedByHeight.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
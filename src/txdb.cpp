@@ -6,17 +6,21 @@
 #include <txdb.h>
 
 #include <claimtrie/trie.h>
+#include <clientversion.h>
+#include <hash.h>
 #include <key_io.h>
 #include <pow.h>
 #include <random.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <streams.h>
 #include <ui_interface.h>
 #include <uint256.h>
 #include <util/system.h>
 #include <util/translation.h>
 
 #include <stdint.h>
+#include <unordered_map>
 #include <boost/thread/interruption.hpp>
 
 static const sqlite::sqlite_config sharedConfig {
@@ -27,7 +31,12 @@ static const sqlite::sqlite_config sharedConfig {
 CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe)
     : db(fMemory ? ":memory:" : (ldb_path / "coins.sqlite").string(), sharedConfig)
 {
-    applyPragmas(db, nCacheSize >> 10); // in -KB
+    if (!fMemory)
+        changePageSize(db, (ldb_path / "coins.sqlite").string(), gArgs.GetArg("-coinsdbpagesize", nDefaultDbPageSize));
+    applyPragmas(db, nCacheSize >> 10, gArgs.GetArg("-coinsdbmmap", nDefaultDbMmap) << 20); // in -KB
+    auto walBudget = gArgs.GetArg("-dbwalbudget", nDefaultDbWalBudget);
+    if (!fMemory && walBudget > 0)
+        checkpointer = std::make_unique<CWalCheckpointer>(db, (ldb_path / "coins.sqlite").string(), walBudget << 20);
 
     db << "CREATE TABLE IF NOT EXISTS unspent (txID BLOB NOT NULL COLLATE BINARY, txN INTEGER NOT NULL, "
           "isCoinbase INTEGER NOT NULL, blockHeight INTEGER NOT NULL, amount INTEGER NOT NULL, "
@@ -105,10 +114,7 @@ bool CCoinsViewDB::BatchWrite(const CCoinsMap &mapCoins, const uint256 &hashBloc
                     dbd << it->first.hash << it->first.n;
                     dbd++;
                 } else {
-                    CTxDestination address;
-                    std::string destination;
-                    if (ExtractDestination(it->second.coin.out.scriptPubKey, address))
-                        destination = EncodeDestination(address);
+                    auto destination = EncodeScriptDestination(it->second.coin.out.scriptPubKey);
                     uint32_t isCoinBase = it->second.coin.fCoinBase; // bit-field
                     uint32_t coinHeight = it->second.coin.nHeight; // bit-field
                     dbi << it->first.hash << it->first.n << isCoinBase << coinHeight
@@ -137,7 +143,12 @@ bool CCoinsViewDB::BatchWrite(const CCoinsMap &mapCoins, const uint256 &hashBloc
         return false;
     }
     LogPrint(BCLog::COINDB, "Committed %zu changed transaction outputs (out of %zu) to coin database...\n", changed, count);
-    if (sync) {
+    if (sync && checkpointer) {
+        if (!checkpointer->sync()) {
+            LogPrintf("%s: Error syncing coin database write-ahead log\n", __func__);
+            return false;
+        }
+    } else if (sync) {
         code = sqlite::sync(db);
         if (code != SQLITE_OK) {
             LogPrintf("%s: Error syncing coin database. SQLite error: %d\n", __func__, code);
@@ -147,6 +158,8 @@ bool CCoinsViewDB::BatchWrite(const CCoinsMap &mapCoins, const uint256 &hashBloc
     return true;
 }
 
+CCoinsViewDB::~CCoinsViewDB() = default;
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     size_t ret = 0;
@@ -154,10 +167,32 @@ size_t CCoinsViewDB::EstimateSize() const
     return ret * 770; // number chosen empirically
 }
 
+std::vector<std::pair<COutPoint, Coin>> CCoinsViewDB::GetCoinsForAddress(const std::string& address) const
+{
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    auto query = db << "SELECT txID, txN, isCoinbase, blockHeight, amount, script FROM unspent "
+                        "WHERE address = ?" << address;
+    for (auto&& row: query) {
+        COutPoint outpoint;
+        Coin coin;
+        uint32_t coinbase = 0, height = 0;
+        row >> outpoint.hash >> outpoint.n >> coinbase >> height >> coin.out.nValue >> coin.out.scriptPubKey;
+        coin.fCoinBase = coinbase;
+        coin.nHeight = height;
+        coins.emplace_back(outpoint, std::move(coin));
+    }
+    return coins;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe)
     : db(fMemory ? ":memory:" : (GetDataDir() / "block_index.sqlite").string(), sharedConfig)
 {
-    applyPragmas(db, nCacheSize >> 10); // in -KB
+    if (!fMemory)
+        changePageSize(db, (GetDataDir() / "block_index.sqlite").string(), gArgs.GetArg("-blockindexpagesize", nDefaultDbPageSize));
+    applyPragmas(db, nCacheSize >> 10, gArgs.GetArg("-blockindexmmap", nDefaultDbMmap) << 20); // in -KB
+    auto walBudget = gArgs.GetArg("-dbwalbudget", nDefaultDbWalBudget);
+    if (!fMemory && walBudget > 0)
+        checkpointer = std::make_unique<CWalCheckpointer>(db, (GetDataDir() / "block_index.sqlite").string(), walBudget << 20);
 
     db << "CREATE TABLE IF NOT EXISTS block_file ("
           "file INTEGER NOT NULL PRIMARY KEY, "
@@ -297,6 +332,9 @@ bool CBlockTreeDB::BatchWrite(const std::vector<std::pair<int, const CBlockFileI
     db << "INSERT OR REPLACE INTO flag VALUES('last_block', ?)" << nLastFile; // TODO: is this always max(file column)?
 
     if(!blockInfo.empty()) {
+        // the snapshot no longer matches what we store
+        db << "DELETE FROM flag WHERE name = 'block_index_snapshot'";
+
         const static uint256 empty;
         auto ibi = db << "INSERT OR REPLACE INTO block_info(hash, prevHash, height, file, dataPos, undoPos, "
                          "txCount, status, version, rootTxHash, rootTrieHash, time, bits, nonce) "
@@ -316,7 +354,12 @@ bool CBlockTreeDB::BatchWrite(const std::vector<std::pair<int, const CBlockFileI
         return false;
     }
     // by Sync they mean disk sync:
-    if (sync) {
+    if (sync && checkpointer) {
+        if (!checkpointer->sync()) {
+            LogPrintf("%s: Error syncing block database write-ahead log\n", __func__);
+            return false;
+        }
+    } else if (sync) {
         code = sqlite::sync(db);
         if (code != SQLITE_OK) {
             LogPrintf("%s: Error syncing block database. SQLite error: %d\n", __func__, code);
@@ -326,6 +369,8 @@ bool CBlockTreeDB::BatchWrite(const std::vector<std::pair<int, const CBlockFileI
     return true;
 }
 
+CBlockTreeDB::~CBlockTreeDB() = default;
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     db << "INSERT OR REPLACE INTO flag VALUES(?, ?)" << name << int(fValue);
     return db.rows_modified() > 0;
@@ -386,4 +431,183 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+static const uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
+
+static fs::path BlockIndexSnapshotPath()
+{
+    return GetDataDir() / "block_index.snapshot";
+}
+
+/** A block index entry as laid out in the snapshot: fixed width, with its parent as a position in the file. */
+struct CBlockIndexSnapshotEntry
+{
+    uint256 hash;
+    int32_t nPrev = -1;
+    int32_t nHeight = 0;
+    int32_t nFile = 0;
+    uint32_t nDataPos = 0;
+    uint32_t nUndoPos = 0;
+    uint32_t nTx = 0;
+    uint32_t nStatus = 0;
+    int32_t nVersion = 0;
+    uint256 hashMerkleRoot;
+    uint256 hashClaimTrie;
+    uint32_t nTime = 0;
+    uint32_t nBits = 0;
+    uint32_t nNonce = 0;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(nPrev);
+        READWRITE(nHeight);
+        READWRITE(nFile);
+        READWRITE(nDataPos);
+        READWRITE(nUndoPos);
+        READWRITE(nTx);
+        READWRITE(nStatus);
+        READWRITE(nVersion);
+        READWRITE(hashMerkleRoot);
+        READWRITE(hashClaimTrie);
+        READWRITE(nTime);
+        READWRITE(nBits);
+        READWRITE(nNonce);
+    }
+};
+
+bool CBlockTreeDB::WriteBlockIndexSnapshot(const std::vector<const CBlockIndex*>& blockInfo, const CBlockIndex* tip)
+{
+    // blockInfo is sorted by height, so every parent is written before its children
+    const auto path = BlockIndexSnapshotPath();
+    const auto pathTmp = path.string() + ".new";
+    CAutoFile file(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: Failed to open %s", __func__, pathTmp);
+
+    CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+    uint256 checksum;
+    std::unordered_map<const CBlockIndex*, int32_t> positions;
+    positions.reserve(blockInfo.size());
+    try {
+        const auto count = uint32_t(blockInfo.size());
+        file << BLOCK_INDEX_SNAPSHOT_VERSION << count << tip->hash;
+        hasher << BLOCK_INDEX_SNAPSHOT_VERSION << count << tip->hash;
+        for (auto bi : blockInfo) {
+            CBlockIndexSnapshotEntry entry;
+            entry.hash = bi->hash;
+            if (bi->pprev) {
+                auto it = positions.find(bi->pprev);
+                assert(it != positions.end());
+                entry.nPrev = it->second;
+            }
+            entry.nHeight = bi->nHeight;
+            entry.nFile = bi->nFile;
+            entry.nDataPos = bi->nDataPos;
+            entry.nUndoPos = bi->nUndoPos;
+            entry.nTx = bi->nTx;
+            entry.nStatus = bi->nStatus;
+            entry.nVersion = bi->nVersion;
+            entry.hashMerkleRoot = bi->hashMerkleRoot;
+            entry.hashClaimTrie = bi->hashClaimTrie;
+            entry.nTime = bi->nTime;
+            entry.nBits = bi->nBits;
+            entry.nNonce = bi->nNonce;
+            positions.emplace(bi, int32_t(positions.size()));
+            file << entry;
+            hasher << entry;
+        }
+        checksum = hasher.GetHash();
+        file << checksum;
+    } catch (const std::exception& e) {
+        return error("%s: Failed to write %s: %s", __func__, pathTmp, e.what());
+    }
+    FileCommit(file.Get());
+    file.fclose();
+    if (!RenameOver(pathTmp, path))
+        return error("%s: Failed to rename %s", __func__, pathTmp);
+
+    db << "INSERT OR REPLACE INTO flag VALUES('block_index_snapshot', ?)" << int64_t(checksum.GetUint64(0));
+    return true;
+}
+
+bool CBlockTreeDB::LoadBlockIndexSnapshot(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, std::vector<CBlockIndex*>& sortedByHeight)
+{
+    int64_t expected = 0;
+    {
+        auto query = db << "SELECT value FROM flag WHERE name = 'block_index_snapshot'";
+        auto it = query.begin();
+        if (it == query.end())
+            return false;
+        *it >> expected;
+    }
+
+    const auto path = BlockIndexSnapshotPath();
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return false;
+
+    uint256 tipHash;
+    bool fFoundTip = false;
+    std::vector<CBlockIndexSnapshotEntry> entries;
+    try {
+        CHashVerifier<CAutoFile> verifier(&file);
+        uint32_t version = 0, count = 0;
+        verifier >> version >> count >> tipHash;
+        if (version != BLOCK_INDEX_SNAPSHOT_VERSION)
+            return false;
+        // the count isn't covered by the checksum yet, so hold it against the file before allocating for it
+        const auto entrySize = GetSerializeSize(CBlockIndexSnapshotEntry(), CLIENT_VERSION);
+        // version, count and tip up front, the checksum at the end
+        const auto fixedSize = GetSerializeSize(version, CLIENT_VERSION) + GetSerializeSize(count, CLIENT_VERSION)
+            + GetSerializeSize(tipHash, CLIENT_VERSION) + GetSerializeSize(uint256(), CLIENT_VERSION);
+        if (fs::file_size(path) != fixedSize + uint64_t(count) * entrySize) {
+            LogPrintf("%s: %s is truncated or corrupt, loading the block index from the database\n", __func__, path.string());
+            return false;
+        }
+        entries.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto& entry = entries[i];
+            verifier >> entry;
+            if (entry.nPrev < -1 || entry.nPrev >= int32_t(i))
+                return error("%s: Out of order entry in %s", __func__, path.string());
+            fFoundTip |= entry.hash == tipHash;
+        }
+        uint256 checksum;
+        file >> checksum;
+        if (checksum != verifier.GetHash() || int64_t(checksum.GetUint64(0)) != expected) {
+            LogPrintf("%s: %s is stale, loading the block index from the database\n", __func__, path.string());
+            return false;
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Failed to read %s: %s\n", __func__, path.string(), e.what());
+        return false;
+    }
+    if (!fFoundTip)
+        return error("%s: %s does not contain its tip %s", __func__, path.string(), tipHash.ToString());
+
+    // entries were checked when they were first loaded or accepted, so proof of work isn't checked again
+    sortedByHeight.reserve(entries.size());
+    for (const auto& entry : entries) {
+        CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+        pindexNew->pprev = entry.nPrev < 0 ? nullptr : sortedByHeight[entry.nPrev];
+        pindexNew->nHeight = entry.nHeight;
+        pindexNew->nFile = entry.nFile;
+        pindexNew->nDataPos = entry.nDataPos;
+        pindexNew->nUndoPos = entry.nUndoPos;
+        pindexNew->nTx = entry.nTx;
+        pindexNew->nStatus = entry.nStatus;
+        pindexNew->nVersion = entry.nVersion;
+        pindexNew->hashMerkleRoot = entry.hashMerkleRoot;
+        pindexNew->hashClaimTrie = entry.hashClaimTrie;
+        pindexNew->nTime = entry.nTime;
+        pindexNew->nBits = entry.nBits;
+        pindexNew->nNonce = entry.nNonce;
+        sortedByHeight.push_back(pindexNew);
+    }
+    LogPrintf("%s: loaded %u entries from %s, tip %s\n", __func__, entries.size(), path.string(), tipHash.ToString());
+    return true;
+}
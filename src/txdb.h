@@ -54,6 +54,7 @@ namespace sqlite {
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CWalCheckpointer;
 class uint256;
 
 //! No need to periodic flush if at least this much space still available.
@@ -62,6 +63,12 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 480;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -claimtriemmap, -coinsdbmmap and -blockindexmmap default (MiB, 0 = read pages with read())
+static const int64_t nDefaultDbMmap = 0;
+//! -claimtriepagesize, -coinsdbpagesize and -blockindexpagesize default (0 = keep the current page size)
+static const int nDefaultDbPageSize = 0;
+//! -dbwalbudget default (MiB of WAL before checkpoints stop being passive, 0 = checkpoint on the writer's thread)
+static const int64_t nDefaultDbWalBudget = 64;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -78,12 +85,14 @@ class CCoinsViewDB final : public CCoinsView
 {
     friend CCoinsViewDBCursor;
     mutable sqlite::database db;
+    std::unique_ptr<CWalCheckpointer> checkpointer;
 
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
      */
     explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -92,6 +101,9 @@ public:
     bool BatchWrite(const CCoinsMap &mapCoins, const uint256 &hashBlock, bool sync) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
+
+    //! Unspent coins paying to an encoded address, as of the last flush
+    std::vector<std::pair<COutPoint, Coin>> GetCoinsForAddress(const std::string& address) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -118,9 +130,11 @@ private:
 class CBlockTreeDB
 {
     sqlite::database db;
+    std::unique_ptr<CWalCheckpointer> checkpointer;
 
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CBlockTreeDB();
 
     bool BatchWrite(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo,
                     int nLastFile, const std::vector<const CBlockIndex*>& blockInfo, bool sync);
@@ -131,6 +145,10 @@ public:
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /** Write every block index entry to a flat file next to the database, which vouches for it until block_info next changes. */
+    bool WriteBlockIndexSnapshot(const std::vector<const CBlockIndex*>& blockInfo, const CBlockIndex* tip);
+    /** Load the block index from that file if it is still current; sortedByHeight gets the entries in file order. */
+    bool LoadBlockIndexSnapshot(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, std::vector<CBlockIndex*>& sortedByHeight);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <assert.h>
 #include <atomic>
 #include <map>
 #include <memory>
@@ -131,6 +132,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t m_epoch{0}; //!< Last mempool traversal that visited this entry
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -531,7 +533,33 @@ public:
     const setEntries & GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    typedef std::map<txiter, std::vector<txiter>, CompareIteratorByHash> cacheMap;
+
+    /**
+     * Ancestor and descendant walks mark the entries they reach with the number of the walk
+     * rather than collecting them in a set, so checking whether an entry was seen already is
+     * a comparison instead of a lookup. Each walk holds an EpochGuard for its duration, which
+     * starts a new number; walks don't nest.
+     */
+    mutable uint64_t m_epoch{0};
+    mutable bool m_has_epoch_guard{false};
+
+    class EpochGuard
+    {
+        const CTxMemPool& pool;
+    public:
+        explicit EpochGuard(const CTxMemPool& in);
+        ~EpochGuard();
+    };
+
+    /** Mark an entry as reached by the current walk, returning whether it was already */
+    bool visited(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        assert(m_has_epoch_guard);
+        const bool ret = it->m_epoch >= m_epoch;
+        it->m_epoch = m_epoch;
+        return ret;
+    }
 
     struct TxLinks {
         setEntries parents;
@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2019 The LBRY Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UNIVALUE_BUILDER_H
+#define BITCOIN_UNIVALUE_BUILDER_H
+
+#include <univalue.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Building blocks for large RPC replies that hand values over instead of copying them.
+ *
+ * UniValue is a subtree of the upstream library, and its push_back and pushKV only take
+ * const references, so each nested object or array is copied, children and all, into its
+ * parent. These put a null in its place, which is cheap to copy, and then move the value
+ * into that slot. The slot is reached through getValues(), which hands out a const
+ * reference to the value's own storage; the value itself isn't const, so writing to it is
+ * fine, and nothing else in UniValue caches anything that this would get out of step with.
+ */
+
+inline std::vector<UniValue>& UniValueSlots(UniValue& value)
+{
+    return const_cast<std::vector<UniValue>&>(value.getValues());
+}
+
+/** Reserve room for n items of an array, or members of an object, about to be added */
+inline void UniValueReserve(UniValue& value, std::size_t n)
+{
+    UniValueSlots(value).reserve(n);
+    if (value.isObject())
+        const_cast<std::vector<std::string>&>(value.getKeys()).reserve(n);
+}
+
+/** Append to an array, moving item in */
+inline void PushBackMove(UniValue& array, UniValue&& item)
+{
+    if (array.push_back(NullUniValue))
+        UniValueSlots(array).back() = std::move(item);
+}
+
+/** Set a member of an object as pushKV does, replacing one of the same key, but moving item in */
+inline void PushKVMove(UniValue& object, const std::string& key, UniValue&& item)
+{
+    if (!object.pushKV(key, NullUniValue))
+        return;
+    const auto& keys = object.getKeys();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) {
+            UniValueSlots(object)[i] = std::move(item);
+            return;
+        }
+    }
+}
+
+/**
+ * Add a member to an object, moving item in. Like __pushKV, and unlike pushKV, it doesn't look
+ * for a member of the same key to replace, which takes a scan of every key so far: use it for
+ * large objects whose keys are unique by construction.
+ */
+inline void PushKVMoveUnique(UniValue& object, const std::string& key, UniValue&& item)
+{
+    if (!object.isObject())
+        return;
+    object.__pushKV(key, NullUniValue);
+    UniValueSlots(object).back() = std::move(item);
+}
+
+#endif // BITCOIN_UNIVALUE_BUILDER_H
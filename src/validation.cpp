@@ -131,6 +131,11 @@ CClaimTrie& Claimtrie() {
         auto fReindexChainState = gArgs.GetBoolArg("-reindex-chainstate", false);
         auto fReindex = gArgs.GetBoolArg("-reindex", false);
         auto& consensus = Params().GetConsensus();
+        int takeoverWindow = gArgs.GetArg("-compacttakeovers", DEFAULT_TAKEOVER_HISTORY_WINDOW);
+        if (takeoverWindow > 0)
+            takeoverWindow = std::max(takeoverWindow, int(MIN_BLOCKS_TO_KEEP));
+        int prefetchDepth = std::max(0, int(gArgs.GetArg("-claimtrieprefetch", DEFAULT_CLAIMTRIE_PREFETCH_DEPTH)));
+        int64_t mmapBytes = std::max(int64_t(0), gArgs.GetArg("-claimtriemmap", nDefaultDbMmap)) << 20;
         g_claimtrie = std::make_unique<CClaimTrie>(nTotalCache / 4,
                                 fReindex || fReindexChainState, 0,
                                 GetDataDir().string(),
@@ -141,7 +146,11 @@ CClaimTrie& Claimtrie() {
                                 consensus.nExtendedClaimExpirationTime,
                                 consensus.nExtendedClaimExpirationForkHeight,
                                 consensus.nAllClaimsInMerkleForkHeight,
-                                Params().NetworkIDString() == CBaseChainParams::MAIN ? 32 : 1);
+                                Params().NetworkIDString() == CBaseChainParams::MAIN ? 32 : 1,
+                                takeoverWindow, prefetchDepth, mmapBytes,
+                                gArgs.GetArg("-claimtriepagesize", nDefaultDbPageSize),
+                                std::max(int64_t(0), gArgs.GetArg("-dbwalbudget", nDefaultDbWalBudget)) << 20,
+                                gArgs.GetBoolArg("-claimtriearchive", DEFAULT_CLAIMTRIE_ARCHIVE));
     };
     return *g_claimtrie;
 }
@@ -487,6 +496,9 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
     return CheckInputs(tx, state, view, flags, cacheSigStore, true, txdata);
 }
 
+// Script checks run by the -par threads, for blocks and for transactions entering the mempool
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
 namespace {
 
 class MemPoolAccept
@@ -977,6 +989,18 @@ bool MemPoolAccept::PolicyScriptChecks(ATMPArgs& args, Workspace& ws, Precompute
 
     constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
 
+    // Spread the inputs over the script check threads, as blocks do. Only
+    // running them inline below tells why a transaction fails though, so
+    // those that do are checked again that way.
+    if (nScriptCheckThreads && tx.vin.size() > 1) {
+        std::vector<CScriptCheck> vChecks;
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        if (CheckInputs(tx, state, m_view, scriptVerifyFlags, true, false, txdata, &vChecks)) {
+            control.Add(vChecks);
+            if (control.Wait()) return true;
+        }
+    }
+
     // Check against previous transactions
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
     if (!CheckInputs(tx, state, m_view, scriptVerifyFlags, true, false, txdata)) {
@@ -1909,8 +1933,6 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck(int worker_num) {
     util::ThreadRename(strprintf("scriptch.%i", worker_num));
     scriptcheckqueue.Thread();
@@ -2020,6 +2042,7 @@ static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
+static int64_t nTimeClaimtrie = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
@@ -2344,6 +2367,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         // inserted into the trie in the first place.
     }
 
+    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
+
     // TODO: if the "just check" flag is set, we should reduce the work done here. Incrementing blocks twice per mine is not efficient.
     assert(trieCache.incrementBlock());
 
@@ -2354,8 +2380,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                         block.hashClaimTrie.GetHex(), pindex->nHeight), REJECT_INVALID, "bad-claim-merkle-hash");
     }
 
-    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
-    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
+    int64_t nTimeTrie = GetTimeMicros(); nTimeClaimtrie += nTimeTrie - nTime3;
+    LogPrint(BCLog::BENCH, "      - Claimtrie update and hash: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTimeTrie - nTime3), nTimeClaimtrie * MICRO, nTimeClaimtrie * MILLI / nBlocksTotal);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
     if (block.vtx[0]->GetValueOut() > blockReward)
@@ -2393,6 +2419,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     return true;
 }
 
+ConnectBlockTimings GetConnectBlockTimings()
+{
+    AssertLockHeld(cs_main);
+    return ConnectBlockTimings{nBlocksTotal, nTimeCheck, nTimeForks, nTimeConnect, nTimeClaimtrie, nTimeVerify, nTimeIndex, nTimeCallbacks};
+}
+
 bool CChainState::FlushStateToDisk(
     const CChainParams& chainparams,
     CValidationState &state,
@@ -4236,16 +4268,26 @@ bool BlockManager::LoadBlockIndex(
     CBlockTreeDB& blocktree,
     std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
-        return false;
+    auto insertBlockIndex = [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); };
 
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(m_block_index.size());
-    for (auto pindex : m_block_index)
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    std::vector<CBlockIndex*> vSnapshot;
+    if (blocktree.LoadBlockIndexSnapshot(insertBlockIndex, vSnapshot)) {
+        // already in height order
+        vSortedByHeight.reserve(vSnapshot.size());
+        for (auto pindex : vSnapshot)
+            vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    } else {
+        if (!blocktree.LoadBlockIndexGuts(consensus_params, insertBlockIndex))
+            return false;
+
+        vSortedByHeight.reserve(m_block_index.size());
+        for (auto pindex : m_block_index)
+            vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
 
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
+        sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    }
     for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight) {
         if (ShutdownRequested()) return false;
         CBlockIndex* pindex = item.second;
@@ -4750,6 +4792,20 @@ void UnloadBlockIndex()
     ::ChainstateActive().UnloadBlockIndex();
 }
 
+bool WriteBlockIndexSnapshot()
+{
+    AssertLockHeld(cs_main);
+    // only when everything in memory has made it to the database, as the database vouches for the snapshot
+    if (!pblocktree || !setDirtyBlockIndex.empty() || !::ChainActive().Tip())
+        return false;
+
+    std::vector<const CBlockIndex*> vSortedByHeight(g_blockman.m_block_index.begin(), g_blockman.m_block_index.end());
+    std::sort(vSortedByHeight.begin(), vSortedByHeight.end(), [](const CBlockIndex* a, const CBlockIndex* b) {
+        return a->nHeight < b->nHeight;
+    });
+    return pblocktree->WriteBlockIndexSnapshot(vSortedByHeight, ::ChainActive().Tip());
+}
+
 bool LoadBlockIndex(const CChainParams& chainparams)
 {
     // Load block index from databases
@@ -122,7 +122,11 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+static const bool DEFAULT_BLOCKINDEX_SNAPSHOT = true;
 static const bool DEFAULT_TXINDEX = true;
+static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_CLAIMINDEX = false;
+static const bool DEFAULT_SPENTINDEX = false;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -138,6 +142,12 @@ static const int MAX_UNCONNECTING_HEADERS = 10;
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
+/** Default for -compacttakeovers (0 = keep the full takeover history in the takeover table) */
+static const int DEFAULT_TAKEOVER_HISTORY_WINDOW = 0;
+/** Default for -claimtrieprefetch, blocks ahead of the tip to warm up claimtrie rows for (0 = disabled) */
+static const int DEFAULT_CLAIMTRIE_PREFETCH_DEPTH = 0;
+/** Default for -claimtriearchive, keeping spent claims and supports for queries at any height */
+static const bool DEFAULT_CLAIMTRIE_ARCHIVE = false;
 
 extern CScript COINBASE_FLAGS;
 extern CCriticalSection cs_main;
@@ -242,6 +252,8 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
  * initializing state if we're running with -reindex. */
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Write the block index to a snapshot LoadBlockIndex can read instead of the database, at clean shutdown */
+bool WriteBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
@@ -257,6 +269,20 @@ bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::P
 bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock = std::shared_ptr<const CBlock>(), bool lastInBatch = true);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
 
+/** Time spent in each phase of ConnectBlock since startup, in microseconds, as logged with -debug=bench. */
+struct ConnectBlockTimings
+{
+    int64_t nBlocks;
+    int64_t nCheck;
+    int64_t nForks;
+    int64_t nConnect;
+    int64_t nClaimtrie;
+    int64_t nVerify; //!< includes nConnect and nClaimtrie, as scripts are checked while those run
+    int64_t nIndex;
+    int64_t nCallbacks;
+};
+ConnectBlockTimings GetConnectBlockTimings() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Guess verification progress (as a fraction between 0.0=genesis and 1.0=current tip). */
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex* pindex);
 
@@ -291,6 +291,67 @@ bool KnapsackSolver(const CAmount& nTargetValue, std::vector<OutputGroup>& group
     return true;
 }
 
+void LimitSelectionPool(std::vector<OutputGroup>& groups, const CAmount& target, const CAmount& max_value, size_t max_size)
+{
+    if (groups.size() <= max_size)
+        return;
+
+    // the groups that can be part of a solution, by the position of the highest bit of their value
+    std::vector<std::vector<size_t>> buckets(64);
+    size_t lowest_larger = groups.size();
+    for (size_t i = 0; i < groups.size(); ++i) {
+        const CAmount value = groups[i].effective_value;
+        if (value > max_value) {
+            if (lowest_larger == groups.size() || value < groups[lowest_larger].effective_value)
+                lowest_larger = i;
+            continue;
+        }
+        size_t bit = 0;
+        while (bit < 63 && (value >> (bit + 1)) > 0)
+            ++bit;
+        buckets[bit].push_back(i);
+    }
+
+    // fill the smallest buckets first, so that the share they can't use goes to the bigger ones
+    std::sort(buckets.begin(), buckets.end(), [](const std::vector<size_t>& a, const std::vector<size_t>& b) {
+        return a.size() < b.size();
+    });
+    size_t room = max_size;
+    size_t buckets_left = std::count_if(buckets.begin(), buckets.end(), [](const std::vector<size_t>& bucket) {
+        return !bucket.empty();
+    });
+
+    FastRandomContext insecure_rand;
+    std::vector<bool> keep(groups.size(), false);
+    CAmount kept_value = 0;
+    for (auto& bucket : buckets) {
+        if (bucket.empty())
+            continue;
+        const size_t share = std::max<size_t>(room / buckets_left--, 1);
+        if (bucket.size() > share) {
+            Shuffle(bucket.begin(), bucket.end(), insecure_rand);
+            bucket.resize(share);
+        }
+        for (size_t i : bucket) {
+            keep[i] = true;
+            kept_value += groups[i].effective_value;
+        }
+        room -= std::min(room, bucket.size());
+    }
+    if (kept_value < target)
+        return;
+    if (lowest_larger != groups.size())
+        keep[lowest_larger] = true;
+
+    std::vector<OutputGroup> kept;
+    kept.reserve(max_size + 1);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        if (keep[i])
+            kept.push_back(std::move(groups[i]));
+    }
+    groups = std::move(kept);
+}
+
 /******************************************************************************
 
  OutputGroup
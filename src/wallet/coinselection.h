@@ -93,6 +93,22 @@ struct OutputGroup
     bool EligibleForSpending(const CoinEligibilityFilter& eligibility_filter) const;
 };
 
+//! knapsack pools with more groups than this are narrowed down by LimitSelectionPool before they're searched
+static const size_t MAX_SELECTION_POOL = 2000;
+
+/**
+ * Narrow a large pool down to max_size groups that still leave plenty of ways to pay target.
+ * Groups worth more than max_value can't be part of a solution, so only the smallest of them is
+ * kept, for the knapsack solver to fall back to. The rest are put in buckets by order of
+ * magnitude, and each bucket keeps an even share of max_size, picked at random, so that coins of
+ * every size stay in reach without searching through all of them. The pool is left as it was if
+ * what would be kept falls short of target.
+ *
+ * This is for the knapsack solver, which looks for a close enough sum: branch and bound looks for
+ * an exact one, which could be among the groups left out, so it gets the whole pool.
+ */
+void LimitSelectionPool(std::vector<OutputGroup>& groups, const CAmount& target, const CAmount& max_value, size_t max_size = MAX_SELECTION_POOL);
+
 bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees);
 
 // Original coin selection algorithm as a fallback
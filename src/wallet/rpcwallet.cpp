@@ -3091,12 +3091,10 @@ static UniValue getwalletinfo(const JSONRPCRequest& request)
     obj.pushKV("walletname", pwallet->GetName());
     obj.pushKV("walletversion", pwallet->GetVersion());
     auto balance = pwallet->GetBalance();
-    auto claims = pwallet->GetBalance(ISMINE_CLAIM);
-    auto supports = pwallet->GetBalance(ISMINE_SUPPORT);
     obj.pushKV("balance",       ValueFromAmount(balance.m_mine_trusted));
-    obj.pushKV("available_balance",       ValueFromAmount(balance.m_mine_trusted - claims.m_mine_trusted - supports.m_mine_trusted));
-    obj.pushKV("staked_claim_balance", ValueFromAmount(claims.m_mine_trusted));
-    obj.pushKV("staked_support_balance",  ValueFromAmount(supports.m_mine_trusted));
+    obj.pushKV("available_balance",       ValueFromAmount(balance.m_mine_trusted - balance.m_mine_trusted_claims - balance.m_mine_trusted_supports));
+    obj.pushKV("staked_claim_balance", ValueFromAmount(balance.m_mine_trusted_claims));
+    obj.pushKV("staked_support_balance",  ValueFromAmount(balance.m_mine_trusted_supports));
     obj.pushKV("unconfirmed_balance", ValueFromAmount(balance.m_mine_untrusted_pending));
     obj.pushKV("immature_balance",    ValueFromAmount(balance.m_mine_immature));
     obj.pushKV("txcount",       (int)pwallet->mapWallet.size());
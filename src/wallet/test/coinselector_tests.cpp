@@ -261,6 +261,17 @@ BOOST_AUTO_TEST_CASE(bnb_search_test)
     BOOST_CHECK(testWallet.SelectCoins(vCoins, 10 * CENT, setCoinsRet, nValueRet, coin_control, coin_selection_params_bnb, bnb_used));
     BOOST_CHECK(!bnb_used);
     BOOST_CHECK(!coin_selection_params_bnb.use_bnb);
+
+    // The one exact match among more coins of one size than LimitSelectionPool would keep is still found
+    empty_wallet();
+    for (int i = 0; i < 5000; ++i)
+        add_coin(COIN + i * 1000);
+    CoinSelectionParams coin_selection_params_exact(true, 0, 0, CFeeRate(0), 0);
+    BOOST_CHECK(testWallet.SelectCoinsMinConf(COIN + 4000 * 1000, filter_standard, GroupCoins(vCoins), setCoinsRet, nValueRet, coin_selection_params_exact, bnb_used));
+    BOOST_CHECK(bnb_used);
+    BOOST_CHECK_EQUAL(nValueRet, COIN + 4000 * 1000);
+    BOOST_CHECK_EQUAL(setCoinsRet.size(), 1U);
+    empty_wallet();
 }
 
 BOOST_AUTO_TEST_CASE(knapsack_solver_test)
@@ -564,6 +575,41 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(limit_selection_pool_test)
+{
+    std::vector<CInputCoin> utxo_pool;
+    for (int i = 0; i < 5000; ++i) {
+        add_coin((1 + i % 10) * CENT / 10, i % 4, utxo_pool);
+    }
+    add_coin(50 * CENT, 0, utxo_pool);
+    add_coin(30 * COIN, 0, utxo_pool);
+    add_coin(20 * COIN, 0, utxo_pool);
+
+    // Pools within the limit are left alone
+    std::vector<OutputGroup> groups = GroupCoins(utxo_pool);
+    LimitSelectionPool(groups, COIN / 2, 2 * COIN, groups.size());
+    BOOST_CHECK_EQUAL(groups.size(), utxo_pool.size());
+
+    // Only the smallest group above max_value is kept, and every size of coin keeps a share
+    groups = GroupCoins(utxo_pool);
+    LimitSelectionPool(groups, COIN / 2, 2 * COIN, 100);
+    BOOST_CHECK_LE(groups.size(), 101U);
+    std::map<CAmount, int> counts;
+    for (const OutputGroup& group : groups) {
+        counts[group.m_value]++;
+    }
+    BOOST_CHECK_EQUAL(counts[20 * COIN], 1);
+    BOOST_CHECK_EQUAL(counts[30 * COIN], 0);
+    BOOST_CHECK_EQUAL(counts[50 * CENT], 1);
+    BOOST_CHECK(counts[CENT / 10] > 0);
+    BOOST_CHECK(counts[CENT] > 0);
+
+    // Pools that would fall short of the target are left alone
+    groups = GroupCoins(utxo_pool);
+    LimitSelectionPool(groups, 10 * COIN, 10 * COIN, 100);
+    BOOST_CHECK_EQUAL(groups.size(), utxo_pool.size());
+}
+
 // Tests that with the ideal conditions, the coin selector will always be able to find a solution that can pay the target value
 BOOST_AUTO_TEST_CASE(SelectCoins_test)
 {
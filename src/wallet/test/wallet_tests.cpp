@@ -459,6 +459,39 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+// the running totals returned by GetBalance() agree with counting every transaction again
+static void CheckBalanceRecount(CWallet& wallet)
+{
+    const CWallet::Balance balance = wallet.GetBalance();
+    wallet.MarkDirty();
+    const CWallet::Balance recount = wallet.GetBalance();
+    BOOST_CHECK_EQUAL(balance.m_mine_trusted, recount.m_mine_trusted);
+    BOOST_CHECK_EQUAL(balance.m_mine_untrusted_pending, recount.m_mine_untrusted_pending);
+    BOOST_CHECK_EQUAL(balance.m_mine_immature, recount.m_mine_immature);
+    BOOST_CHECK_EQUAL(balance.m_mine_trusted_claims, recount.m_mine_trusted_claims);
+    BOOST_CHECK_EQUAL(balance.m_mine_trusted_supports, recount.m_mine_trusted_supports);
+}
+
+BOOST_FIXTURE_TEST_CASE(balance_tracking, ListCoinsTestingSetup)
+{
+    const CWallet::Balance initial = wallet->GetBalance();
+    BOOST_CHECK_EQUAL(initial.m_mine_trusted, 1 * COIN);
+    CheckBalanceRecount(*wallet);
+
+    // spending a coin counts the change instead, and the block it's mined in matures another coinbase
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 10 * CENT, false /* subtract fee */});
+    const CWallet::Balance spent = wallet->GetBalance();
+    BOOST_CHECK_EQUAL(spent.m_mine_immature, initial.m_mine_immature - 1 * COIN);
+    BOOST_CHECK(spent.m_mine_trusted < 2 * COIN - 10 * CENT);
+    BOOST_CHECK(spent.m_mine_trusted > initial.m_mine_trusted);
+    CheckBalanceRecount(*wallet);
+
+    // the uncached path counts the same at depth 1, as everything is confirmed
+    const CWallet::Balance confirmed = wallet->GetBalance(ISMINE_NO, 1);
+    BOOST_CHECK_EQUAL(confirmed.m_mine_trusted, spent.m_mine_trusted);
+    BOOST_CHECK_EQUAL(confirmed.m_mine_immature, spent.m_mine_immature);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     auto chain = interfaces::MakeChain();
@@ -471,6 +504,60 @@ BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
     BOOST_CHECK(!wallet->GetNewDestination(OutputType::BECH32, "", dest, error));
 }
 
+BOOST_AUTO_TEST_CASE(keypool_topup_derivation)
+{
+    auto chain = interfaces::MakeChain();
+    CKey seed;
+    seed.MakeNewKey(true);
+
+    // one wallet tops up its keypool in bulk, the other derives the same keys one at a time
+    CWallet bulk(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    CWallet single(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    for (CWallet* wallet : {&bulk, &single}) {
+        LOCK(wallet->cs_wallet);
+        wallet->SetMinVersion(FEATURE_LATEST);
+        wallet->SetHDSeed(wallet->DeriveNewSeed(seed));
+    }
+    BOOST_CHECK(bulk.TopUpKeyPool(500));
+
+    LOCK2(bulk.cs_wallet, single.cs_wallet);
+    BOOST_CHECK_EQUAL(bulk.GetKeyPoolSize(), 1000U);
+    WalletBatch batch(single.GetDBHandle());
+    for (bool internal : {false, true}) {
+        for (int i = 0; i < 500; ++i) {
+            const CKeyID id = single.GenerateNewKey(batch, internal).GetID();
+            BOOST_CHECK(bulk.HaveKey(id));
+            BOOST_CHECK_EQUAL(bulk.mapKeyMetadata[id].hdKeypath, single.mapKeyMetadata[id].hdKeypath);
+            BOOST_CHECK(bulk.mapKeyMetadata[id].key_origin.path == single.mapKeyMetadata[id].key_origin.path);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ismine_cache)
+{
+    auto chain = interfaces::MakeChain();
+    CWallet wallet(chain.get(), WalletLocation(), WalletDatabase::CreateMock());
+    CKey key, watched;
+    key.MakeNewKey(true);
+    watched.MakeNewKey(true);
+    const CScript script = GetScriptForDestination(PKHash(key.GetPubKey()));
+    const CScript watched_script = GetScriptForDestination(PKHash(watched.GetPubKey()));
+
+    // cached results follow keys and scripts being added and removed
+    LOCK(wallet.cs_wallet);
+    BOOST_CHECK_EQUAL(wallet.IsMine(script), ISMINE_NO);
+    BOOST_CHECK(wallet.AddWatchOnly(script, 0));
+    BOOST_CHECK_EQUAL(wallet.IsMine(script), ISMINE_WATCH_ONLY);
+    BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    BOOST_CHECK_EQUAL(wallet.IsMine(script), ISMINE_SPENDABLE);
+
+    BOOST_CHECK(wallet.AddWatchOnly(watched_script, 0));
+    BOOST_CHECK_EQUAL(wallet.IsMine(watched_script), ISMINE_WATCH_ONLY);
+    BOOST_CHECK(wallet.RemoveWatchOnly(watched_script));
+    BOOST_CHECK_EQUAL(wallet.IsMine(watched_script), ISMINE_NO);
+    BOOST_CHECK_EQUAL(wallet.IsMine(script), ::IsMine(wallet, script));
+}
+
 // Explicit calculation which is used to test the wallet constant
 // We get the same virtual size due to rounding(weight/4) for both use_max_sig values
 static size_t CalculateNestedKeyhashInputSize(bool use_max_sig)
@@ -8,6 +8,7 @@
 #include <chain.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <crypto/sha256.h>
 #include <fs.h>
 #include <interfaces/chain.h>
 #include <interfaces/wallet.h>
@@ -35,6 +36,7 @@
 #include <algorithm>
 #include <cassert>
 #include <future>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -47,6 +49,12 @@ const std::map<uint64_t,std::string> WALLET_FLAG_CAVEATS{
 };
 
 static const size_t OUTPUT_GROUP_MAX_ENTRIES = 10;
+//! scripts whose IsMine result is kept at the most, before the cache is emptied
+static const size_t ISMINE_CACHE_MAX_SIZE = 250000;
+//! keys derived per thread at the least when topping up the keypool
+static const size_t MIN_KEYS_PER_THREAD = 100;
+//! keys written to the database per transaction when topping up the keypool
+static const int64_t KEYPOOL_WRITE_BATCH = 10000;
 
 static CCriticalSection cs_wallets;
 static std::vector<std::shared_ptr<CWallet>> vpwallets GUARDED_BY(cs_wallets);
@@ -306,20 +314,99 @@ CPubKey CWallet::GenerateNewKey(WalletBatch &batch, bool internal)
     return pubkey;
 }
 
-void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal)
+void CWallet::GenerateNewKeys(WalletBatch& batch, int64_t count, bool internal, std::vector<CPubKey>& pubkeys)
+{
+    AssertLockHeld(cs_wallet);
+    const size_t target = pubkeys.size() + count;
+    pubkeys.reserve(target);
+    if (!IsHDEnabled()) {
+        while (pubkeys.size() < target)
+            pubkeys.push_back(GenerateNewKey(batch, internal));
+        return;
+    }
+
+    assert(!IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS));
+    assert(!IsWalletFlagSet(WALLET_FLAG_BLANK_WALLET));
+    internal = internal && CanSupportFeature(FEATURE_HD_SPLIT);
+    if (CanSupportFeature(FEATURE_COMPRPUBKEY)) {
+        SetMinVersion(FEATURE_COMPRPUBKEY);
+    }
+
+    CExtKey chainChildKey;
+    CKeyID master_id;
+    DeriveChainKey(chainChildKey, master_id, internal);
+    uint32_t& counter = internal ? hdChain.nInternalChainCounter : hdChain.nExternalChainCounter;
+    const int64_t nCreationTime = GetTime();
+
+    while (pubkeys.size() < target) {
+        // children of the same chain key are derived independently of each other, so spread them over threads
+        const uint32_t first = counter;
+        const size_t n = target - pubkeys.size();
+        std::vector<CKey> secrets(n);
+        std::vector<CPubKey> derived(n);
+        auto derive = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                CExtKey childKey;
+                chainChildKey.Derive(childKey, (first + i) | BIP32_HARDENED_KEY_LIMIT);
+                secrets[i] = childKey.key;
+                derived[i] = childKey.key.GetPubKey();
+                assert(secrets[i].VerifyPubKey(derived[i]));
+            }
+        };
+        const size_t threads = std::max<size_t>(std::min<size_t>(GetNumCores(), n / MIN_KEYS_PER_THREAD), 1);
+        std::vector<std::thread> workers;
+        {
+            // joined even if this thread's share throws, as destroying a joinable thread terminates
+            struct Joiner {
+                std::vector<std::thread>& threads;
+                ~Joiner() { for (auto& thread : threads) if (thread.joinable()) thread.join(); }
+            } joiner{workers};
+            for (size_t t = 1; t < threads; ++t)
+                workers.emplace_back(derive, n * t / threads, n * (t + 1) / threads);
+            derive(0, n / threads);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t index = first + i;
+            counter = index + 1;
+            // skip keys already known to the wallet, as DeriveNewChildKey does
+            if (HaveKey(derived[i].GetID()))
+                continue;
+            CKeyMetadata metadata(nCreationTime);
+            metadata.hdKeypath = std::string(internal ? "m/0'/1'/" : "m/0'/0'/") + std::to_string(index) + "'";
+            metadata.key_origin.path.push_back(0 | BIP32_HARDENED_KEY_LIMIT);
+            metadata.key_origin.path.push_back((internal ? 1 : 0) | BIP32_HARDENED_KEY_LIMIT);
+            metadata.key_origin.path.push_back(index | BIP32_HARDENED_KEY_LIMIT);
+            metadata.hd_seed_id = hdChain.seed_id;
+            std::copy(master_id.begin(), master_id.begin() + 4, metadata.key_origin.fingerprint);
+            metadata.has_key_origin = true;
+            mapKeyMetadata[derived[i].GetID()] = metadata;
+            pubkeys.push_back(derived[i]);
+            if (!AddKeyPubKeyWithDB(batch, secrets[i], derived[i])) {
+                throw std::runtime_error(std::string(__func__) + ": AddKey failed");
+            }
+        }
+    }
+    UpdateTimeFirstKey(nCreationTime);
+
+    // update the chain model in the database, once for all of them
+    if (!batch.WriteHDChain(hdChain))
+        throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
+}
+
+void CWallet::DeriveChainKey(CExtKey& chainChildKey, CKeyID& master_id, bool internal) const
 {
     // for now we use a fixed keypath scheme of m/0'/0'/k
     CKey seed;                     //seed (256bit)
     CExtKey masterKey;             //hd master key
     CExtKey accountKey;            //key at m/0'
-    CExtKey chainChildKey;         //key at m/0'/0' (external) or m/0'/1' (internal)
-    CExtKey childKey;              //key at m/0'/0'/<n>'
 
     // try to get the seed
     if (!GetKey(hdChain.seed_id, seed))
         throw std::runtime_error(std::string(__func__) + ": seed not found");
 
     masterKey.SetSeed(seed.begin(), seed.size());
+    master_id = masterKey.key.GetPubKey().GetID();
 
     // derive m/0'
     // use hardened derivation (child keys >= 0x80000000 are hardened after bip32)
@@ -328,6 +415,34 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey
     // derive m/0'/0' (external chain) OR m/0'/1' (internal chain)
     assert(internal ? CanSupportFeature(FEATURE_HD_SPLIT) : true);
     accountKey.Derive(chainChildKey, BIP32_HARDENED_KEY_LIMIT+(internal ? 1 : 0));
+}
+
+void CWallet::ForgetUncommittedKeys(const CHDChain& chain, int64_t max_keypool_index, const std::vector<CPubKey>& pubkeys)
+{
+    AssertLockHeld(cs_wallet);
+    hdChain = chain;
+    m_max_keypool_index = max_keypool_index;
+    setInternalKeyPool.erase(setInternalKeyPool.upper_bound(max_keypool_index), setInternalKeyPool.end());
+    setExternalKeyPool.erase(setExternalKeyPool.upper_bound(max_keypool_index), setExternalKeyPool.end());
+    {
+        LOCK(cs_KeyStore);
+        for (const CPubKey& pubkey : pubkeys) {
+            const CKeyID id = pubkey.GetID();
+            m_pool_key_to_index.erase(id);
+            mapKeyMetadata.erase(id);
+            mapKeys.erase(id);
+            mapCryptedKeys.erase(id);
+        }
+    }
+    MarkIsMineStale(true);
+}
+
+void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal)
+{
+    CExtKey chainChildKey;         //key at m/0'/0' (external) or m/0'/1' (internal)
+    CExtKey childKey;              //key at m/0'/0'/<n>'
+    CKeyID master_id;
+    DeriveChainKey(chainChildKey, master_id, internal);
 
     // derive child key at next index, skip keys already known to the wallet
     do {
@@ -353,7 +468,6 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey
     } while (HaveKey(childKey.key.GetPubKey().GetID()));
     secret = childKey.key;
     metadata.hd_seed_id = hdChain.seed_id;
-    CKeyID master_id = masterKey.key.GetPubKey().GetID();
     std::copy(master_id.begin(), master_id.begin() + 4, metadata.key_origin.fingerprint);
     metadata.has_key_origin = true;
     // update the chain model in the database
@@ -507,6 +621,7 @@ bool CWallet::AddCScriptWithDB(WalletBatch& batch, const CScript& redeemScript)
 {
     if (!FillableSigningProvider::AddCScript(redeemScript))
         return false;
+    MarkIsMineStale();
     if (batch.WriteCScript(Hash160(redeemScript), redeemScript)) {
         UnsetWalletFlagWithDB(batch, WALLET_FLAG_BLANK_WALLET);
         return true;
@@ -526,7 +641,10 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
         return true;
     }
 
-    return FillableSigningProvider::AddCScript(redeemScript);
+    if (!FillableSigningProvider::AddCScript(redeemScript))
+        return false;
+    MarkIsMineStale();
+    return true;
 }
 
 static bool ExtractPubKey(const CScript &dest, CPubKey& pubKeyOut)
@@ -545,6 +663,7 @@ bool CWallet::AddWatchOnlyInMem(const CScript &dest)
         mapWatchKeys[pubKey.GetID()] = pubKey;
         ImplicitlyLearnRelatedKeyScripts(pubKey);
     }
+    MarkIsMineStale();
     return true;
 }
 
@@ -593,6 +712,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
         // Related CScripts are not removed; having superfluous scripts around is
         // harmless (see comment in ImplicitlyLearnRelatedKeyScripts).
     }
+    MarkIsMineStale(true);
 
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
@@ -848,6 +968,7 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends[outpoint.hash][outpoint.n].push_back(wtxid);
     setLockedCoins.erase(outpoint);
+    EraseSpendableCoin(outpoint);
     SyncMetaData(outpoint);
 }
 
@@ -861,6 +982,23 @@ void CWallet::AddToSpends(const CWalletTx& wtx)
         AddToSpends(txin.prevout, wtx.GetHash());
 }
 
+void CWallet::AddSpendableCoin(const COutPoint& outpoint) const
+{
+    auto it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size())
+        return;
+    const CTxOut& txout = it->second.tx->vout[outpoint.n];
+    if (IsMine(txout) != ISMINE_NO)
+        setSpendableCoins.emplace(txout.nValue, outpoint);
+}
+
+void CWallet::EraseSpendableCoin(const COutPoint& outpoint)
+{
+    auto it = mapWallet.find(outpoint.hash);
+    if (it != mapWallet.end() && outpoint.n < it->second.tx->vout.size())
+        setSpendableCoins.erase({it->second.tx->vout[outpoint.n].nValue, outpoint});
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -1030,6 +1168,8 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        m_balance_all_stale = true;
+        fSpendableCoinsStale = true;
         for (auto& item : mapWallet)
             item.second.MarkDirty();
     }
@@ -1142,6 +1282,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
         wtx.nTimeSmart = ComputeTimeSmart(wtx);
         AddToSpends(wtx);
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++)
+            AddSpendableCoin(COutPoint(hash, i));
     }
 
     bool fUpdated = false;
@@ -1222,6 +1364,7 @@ void CWallet::LoadToWallet(CWalletTx& wtxIn)
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
     }
+    fSpendableCoinsStale = true;
     AddToSpends(wtx);
     for (const CTxIn& txin : wtx.tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
@@ -1367,6 +1510,8 @@ bool CWallet::AbandonTransaction(interfaces::Chain::Lock& locked_chain, const ui
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            for (const CTxIn& txin : wtx.tx->vin)
+                AddSpendableCoin(txin.prevout);
         }
     }
 
@@ -1423,6 +1568,8 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            for (const CTxIn& txin : wtx.tx->vin)
+                AddSpendableCoin(txin.prevout);
         }
     }
 }
@@ -1446,6 +1593,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkBalanceStale(it->first);
     }
 }
 
@@ -1454,6 +1602,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalanceStale(it->first);
     }
 }
 
@@ -1551,7 +1700,36 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 
 isminetype CWallet::IsMine(const CTxOut& txout) const
 {
-    return ::IsMine(*this, txout.scriptPubKey);
+    return IsMine(txout.scriptPubKey);
+}
+
+isminetype CWallet::IsMine(const CScript& script) const
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    uint64_t generation;
+    {
+        LOCK(cs_ismine_cache);
+        auto it = mapIsMineCache.find(hash);
+        if (it != mapIsMineCache.end() && (it->second.second == nIsMineGeneration || (it->second.first & ISMINE_SPENDABLE)))
+            return it->second.first;
+        generation = nIsMineGeneration;
+    }
+
+    const isminetype mine = ::IsMine(*this, script);
+    LOCK(cs_ismine_cache);
+    if (mapIsMineCache.size() >= ISMINE_CACHE_MAX_SIZE)
+        mapIsMineCache.clear();
+    mapIsMineCache[hash] = std::make_pair(mine, generation);
+    return mine;
+}
+
+void CWallet::MarkIsMineStale(bool removed)
+{
+    LOCK(cs_ismine_cache);
+    if (removed)
+        mapIsMineCache.clear();
+    ++nIsMineGeneration;
 }
 
 CAmount CWallet::GetCredit(const CTxOut& txout, const isminefilter& filter) const
@@ -1575,7 +1753,7 @@ bool CWallet::IsChange(const CScript& script) const
     // a better way of identifying which outputs are 'the send' and which are
     // 'the change' will need to be implemented (maybe extend CWalletTx to remember
     // which output, if any, was change).
-    auto isMine = ::IsMine(*this, script);
+    auto isMine = IsMine(script);
     if (isMine && !(isMine & ISMINE_STAKE)) // stakes are never change
     {
         CTxDestination address;
@@ -2233,7 +2411,10 @@ bool CWalletTx::SubmitMemoryPoolAndRelay(std::string& err_string, bool relay, in
     // out-of-order is incorrect - it should be unmarked when
     // TransactionRemovedFromMempool fires.
     bool ret = pwallet->chain().broadcastTransaction(tx, err_string, pwallet->m_default_max_tx_fee, relay);
-    fInMempool |= ret;
+    if (ret && !fInMempool) {
+        fInMempool = true;
+        pwallet->MarkBalanceStale(GetHash());
+    }
     return ret;
 }
 
@@ -2258,6 +2439,17 @@ CAmount CWalletTx::GetCachableAmount(AmountType type, const isminefilter& filter
     return amount.m_value[filter];
 }
 
+void CWalletTx::MarkDirty()
+{
+    m_amounts[DEBIT].Reset();
+    m_amounts[CREDIT].Reset();
+    m_amounts[IMMATURE_CREDIT].Reset();
+    m_amounts[AVAILABLE_CREDIT].Reset();
+    fChangeCached = false;
+    if (pwallet)
+        pwallet->MarkBalanceStale(GetHash());
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (tx->vin.empty())
@@ -2471,6 +2663,120 @@ void MaybeResendWalletTxs()
  */
 
 
+CWallet::Balance& CWallet::Balance::operator+=(const Balance& other)
+{
+    m_mine_trusted += other.m_mine_trusted;
+    m_mine_untrusted_pending += other.m_mine_untrusted_pending;
+    m_mine_immature += other.m_mine_immature;
+    m_watchonly_trusted += other.m_watchonly_trusted;
+    m_watchonly_untrusted_pending += other.m_watchonly_untrusted_pending;
+    m_watchonly_immature += other.m_watchonly_immature;
+    m_mine_trusted_claims += other.m_mine_trusted_claims;
+    m_mine_trusted_supports += other.m_mine_trusted_supports;
+    return *this;
+}
+
+CWallet::Balance& CWallet::Balance::operator-=(const Balance& other)
+{
+    m_mine_trusted -= other.m_mine_trusted;
+    m_mine_untrusted_pending -= other.m_mine_untrusted_pending;
+    m_mine_immature -= other.m_mine_immature;
+    m_watchonly_trusted -= other.m_watchonly_trusted;
+    m_watchonly_untrusted_pending -= other.m_watchonly_untrusted_pending;
+    m_watchonly_immature -= other.m_watchonly_immature;
+    m_mine_trusted_claims -= other.m_mine_trusted_claims;
+    m_mine_trusted_supports -= other.m_mine_trusted_supports;
+    return *this;
+}
+
+bool CWallet::Balance::IsZero() const
+{
+    return m_mine_trusted == 0 && m_mine_untrusted_pending == 0 && m_mine_immature == 0
+        && m_watchonly_trusted == 0 && m_watchonly_untrusted_pending == 0 && m_watchonly_immature == 0
+        && m_mine_trusted_claims == 0 && m_mine_trusted_supports == 0;
+}
+
+CWallet::Balance CWallet::GetTxBalance(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx, isminefilter filter, int min_depth) const
+{
+    AssertLockHeld(cs_wallet);
+    Balance ret;
+    const bool is_trusted{wtx.IsTrusted(locked_chain)};
+    const int tx_depth{wtx.GetDepthInMainChain(locked_chain)};
+    const CAmount tx_credit_mine{wtx.GetAvailableCredit(locked_chain, /* fUseCache */ true, ISMINE_SPENDABLE | filter)};
+    const CAmount tx_credit_watchonly{wtx.GetAvailableCredit(locked_chain, /* fUseCache */ true, ISMINE_WATCH_ONLY | filter)};
+    if (is_trusted && tx_depth >= min_depth) {
+        ret.m_mine_trusted = tx_credit_mine;
+        ret.m_watchonly_trusted = tx_credit_watchonly;
+        if (tx_credit_mine > 0) {
+            ret.m_mine_trusted_claims = wtx.GetAvailableCredit(locked_chain, /* fUseCache */ true, ISMINE_SPENDABLE | ISMINE_CLAIM);
+            ret.m_mine_trusted_supports = wtx.GetAvailableCredit(locked_chain, /* fUseCache */ true, ISMINE_SPENDABLE | ISMINE_SUPPORT);
+        }
+    }
+    if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+        ret.m_mine_untrusted_pending = tx_credit_mine;
+        ret.m_watchonly_untrusted_pending = tx_credit_watchonly;
+    }
+    ret.m_mine_immature = wtx.GetImmatureCredit(locked_chain);
+    ret.m_watchonly_immature = wtx.GetImmatureWatchOnlyCredit(locked_chain);
+    return ret;
+}
+
+void CWallet::MarkBalanceStale(const uint256& hash) const
+{
+    LOCK(cs_wallet);
+    if (!m_balance_all_stale)
+        m_balance_stale.insert(hash);
+}
+
+void CWallet::UpdateBalance(interfaces::Chain::Lock& locked_chain) const
+{
+    AssertLockHeld(cs_wallet);
+
+    // coinbases mature as the tip moves up, and may turn immature again when it moves back
+    const int height = locked_chain.getHeight().get_value_or(-1);
+    if (height < m_balance_height) {
+        m_balance_all_stale = true;
+    } else if (height > m_balance_height && !m_balance_all_stale) {
+        m_balance_stale.insert(m_balance_maturing.begin(), m_balance_maturing.end());
+    }
+    m_balance_height = height;
+
+    auto recount = [&](const uint256& hash, const CWalletTx* wtx) {
+        auto it = m_tx_balances.find(hash);
+        if (it != m_tx_balances.end()) {
+            m_balance -= it->second;
+            m_tx_balances.erase(it);
+        }
+        m_balance_maturing.erase(hash);
+        if (wtx == nullptr) // no longer in the wallet
+            return;
+        const Balance balance = GetTxBalance(locked_chain, *wtx, ISMINE_NO, 0);
+        if (!balance.IsZero()) {
+            m_balance += balance;
+            m_tx_balances.emplace(hash, balance);
+        }
+        if (wtx->IsCoinBase() && wtx->GetBlocksToMaturity(locked_chain) > 0)
+            m_balance_maturing.insert(hash);
+    };
+
+    if (m_balance_all_stale) {
+        m_balance = Balance{};
+        m_tx_balances.clear();
+        m_balance_maturing.clear();
+        m_balance_stale.clear();
+        m_balance_all_stale = false;
+        for (const auto& entry : mapWallet)
+            recount(entry.first, &entry.second);
+        return;
+    }
+
+    for (const uint256& hash : m_balance_stale) {
+        auto it = mapWallet.find(hash);
+        recount(hash, it != mapWallet.end() ? &it->second : nullptr);
+    }
+    m_balance_stale.clear();
+}
+
 CWallet::Balance CWallet::GetBalance(isminefilter filter, const int min_depth, bool avoid_reuse, CAmount earlyExit) const
 {
     Balance ret;
@@ -2480,23 +2786,15 @@ CWallet::Balance CWallet::GetBalance(isminefilter filter, const int min_depth, b
     {
         auto locked_chain = chain().lock();
         LOCK(cs_wallet);
+        // the default query is kept up to date as transactions change; ISMINE_USED makes no
+        // difference to it unless the wallet avoids reusing addresses
+        if (min_depth == 0 && (filter == ISMINE_NO || (filter == ISMINE_USED && !IsWalletFlagSet(WALLET_FLAG_AVOID_REUSE)))) {
+            UpdateBalance(*locked_chain);
+            return m_balance;
+        }
         for (const auto& entry : mapWallet)
         {
-            const CWalletTx& wtx = entry.second;
-            const bool is_trusted{wtx.IsTrusted(*locked_chain)};
-            const int tx_depth{wtx.GetDepthInMainChain(*locked_chain)};
-            const CAmount tx_credit_mine{wtx.GetAvailableCredit(*locked_chain, /* fUseCache */ true, ISMINE_SPENDABLE | filter)};
-            const CAmount tx_credit_watchonly{wtx.GetAvailableCredit(*locked_chain, /* fUseCache */ true, ISMINE_WATCH_ONLY | filter)};
-            if (is_trusted && tx_depth >= min_depth) {
-                ret.m_mine_trusted += tx_credit_mine;
-                ret.m_watchonly_trusted += tx_credit_watchonly;
-            }
-            if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
-                ret.m_mine_untrusted_pending += tx_credit_mine;
-                ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
-            }
-            ret.m_mine_immature += wtx.GetImmatureCredit(*locked_chain);
-            ret.m_watchonly_immature += wtx.GetImmatureWatchOnlyCredit(*locked_chain);
+            ret += GetTxBalance(*locked_chain, entry.second, filter, min_depth);
             if (earlyExit > 0 && ret.m_mine_trusted >= earlyExit)
                 break;
         }
@@ -2532,10 +2830,28 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     const int min_depth = {coinControl ? coinControl->m_min_depth : DEFAULT_MIN_DEPTH};
     const int max_depth = {coinControl ? coinControl->m_max_depth : DEFAULT_MAX_DEPTH};
 
-    for (const auto& entry : mapWallet)
+    if (fSpendableCoinsStale) {
+        setSpendableCoins.clear();
+        for (const auto& entry : mapWallet) {
+            for (unsigned int i = 0; i < entry.second.tx->vout.size(); i++) {
+                if (!IsSpent(locked_chain, entry.first, i))
+                    AddSpendableCoin(COutPoint(entry.first, i));
+            }
+        }
+        fSpendableCoinsStale = false;
+    }
+
+    // largest first, out of those within the amounts asked for
+    typedef std::set<std::pair<CAmount, COutPoint>>::const_reverse_iterator reverse_iterator;
+    const reverse_iterator end(setSpendableCoins.lower_bound({nMinimumAmount, COutPoint(uint256(), 0)}));
+    for (reverse_iterator coin(setSpendableCoins.lower_bound({nMaximumAmount + 1, COutPoint(uint256(), 0)})); coin != end; ++coin)
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+        const COutPoint& outpoint = coin->second;
+        auto it = mapWallet.find(outpoint.hash);
+        if (it == mapWallet.end())
+            continue;
+        const uint256& wtxid = it->first;
+        const CWalletTx& wtx = it->second;
 
         if (!locked_chain.checkFinalTx(*wtx.tx)) {
             continue;
@@ -2594,57 +2910,54 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
             continue;
         }
 
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
-            if (wtx.tx->vout[i].nValue < nMinimumAmount || wtx.tx->vout[i].nValue > nMaximumAmount)
-                continue;
-
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
-                continue;
+        const unsigned int i = outpoint.n;
 
-            if (IsLockedCoin(entry.first, i))
-                continue;
+        if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(outpoint))
+            continue;
 
-            if (IsSpent(locked_chain, wtxid, i))
-                continue;
+        if (IsLockedCoin(wtxid, i))
+            continue;
 
-            isminetype mine = IsMine(wtx.tx->vout[i]);
+        if (IsSpent(locked_chain, wtxid, i))
+            continue;
 
-            if (mine == ISMINE_NO) {
-                continue;
-            }
+        isminetype mine = IsMine(wtx.tx->vout[i]);
 
-            // spending claims or supports requires specific selection:
-            auto isClaimCoin = bool(mine & ISMINE_STAKE);
-            auto claimSpendRequested = isClaimCoin && coinControl && coinControl->IsSelected(COutPoint(entry.first, i));
-            if (isClaimCoin && !claimSpendRequested)
-                continue;
+        if (mine == ISMINE_NO) {
+            continue;
+        }
 
-            bool solvable = false, computedSolvable = false;
-            bool spendable = bool(mine & ISMINE_SPENDABLE);
-            if (!spendable && bool(mine & ISMINE_WATCH_ONLY) && coinControl && coinControl->fAllowWatchOnly) {
-                solvable = IsSolvable(*this,  wtx.tx->vout[i].scriptPubKey); // this is a slow call
-                spendable = solvable;
-                computedSolvable = true;
-            }
-            if (computeSolvable && !computedSolvable)
-                solvable = IsSolvable(*this, wtx.tx->vout[i].scriptPubKey);
+        // spending claims or supports requires specific selection:
+        auto isClaimCoin = bool(mine & ISMINE_STAKE);
+        auto claimSpendRequested = isClaimCoin && coinControl && coinControl->IsSelected(outpoint);
+        if (isClaimCoin && !claimSpendRequested)
+            continue;
 
-            vCoins.emplace_back(&wtx, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly));
+        bool solvable = false, computedSolvable = false;
+        bool spendable = bool(mine & ISMINE_SPENDABLE);
+        if (!spendable && bool(mine & ISMINE_WATCH_ONLY) && coinControl && coinControl->fAllowWatchOnly) {
+            solvable = IsSolvable(*this,  wtx.tx->vout[i].scriptPubKey); // this is a slow call
+            spendable = solvable;
+            computedSolvable = true;
+        }
+        if (computeSolvable && !computedSolvable)
+            solvable = IsSolvable(*this, wtx.tx->vout[i].scriptPubKey);
 
-            // Checks the sum amount of all UTXO's.
-            if (nMinimumSumAmount != MAX_MONEY) {
-                nTotal += wtx.tx->vout[i].nValue;
+        vCoins.emplace_back(&wtx, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly));
 
-                if (nTotal >= nMinimumSumAmount) {
-                    return;
-                }
-            }
+        // Checks the sum amount of all UTXO's.
+        if (nMinimumSumAmount != MAX_MONEY) {
+            nTotal += wtx.tx->vout[i].nValue;
 
-            // Checks the maximum number of UTXO's.
-            if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            if (nTotal >= nMinimumSumAmount) {
                 return;
             }
         }
+
+        // Checks the maximum number of UTXO's.
+        if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            return;
+        }
     }
 }
 
@@ -2739,18 +3052,21 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibil
                     it = group.Discard(coin);
                 }
             }
-            if (group.effective_value > 0) utxo_pool.push_back(group);
+            if (group.effective_value > 0) utxo_pool.push_back(std::move(group));
         }
         // Calculate the fees for things that aren't inputs
         CAmount not_input_fees = coin_selection_params.effective_fee.GetFee(coin_selection_params.tx_noinputs_size);
+        // the whole pool, as narrowing it could drop an exact match; TOTAL_TRIES bounds the search anyway
         bnb_used = true;
         return SelectCoinsBnB(utxo_pool, nTargetValue, cost_of_change, setCoinsRet, nValueRet, not_input_fees);
     } else {
         // Filter by the min conf specs and add to utxo_pool
-        for (const OutputGroup& group : groups) {
+        for (OutputGroup& group : groups) {
             if (!group.EligibleForSpending(eligibility_filter)) continue;
-            utxo_pool.push_back(group);
+            utxo_pool.push_back(std::move(group));
         }
+        // groups worth MIN_CHANGE more than the target are only ever used on their own
+        LimitSelectionPool(utxo_pool, nTargetValue, nTargetValue + MIN_CHANGE - 1);
         bnb_used = false;
         return KnapsackSolver(nTargetValue, utxo_pool, setCoinsRet, nValueRet);
     }
@@ -3470,8 +3786,12 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
                 if (mit->second.erase(txin.prevout.n) && mit->second.empty())
                     mapTxSpends.erase(mit);
             }
+            AddSpendableCoin(txin.prevout);
         }
+        for (unsigned int i = 0; i < it->second.tx->vout.size(); i++)
+            EraseSpendableCoin(COutPoint(hash, i));
         mapWallet.erase(it);
+        MarkBalanceStale(hash);
         NotifyTransactionChanged(this, hash, CT_DELETED);
     }
 
@@ -3670,16 +3990,28 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             // don't create extra internal keys
             missingInternal = 0;
         }
-        bool internal = false;
         WalletBatch batch(*database);
-        for (int64_t i = missingInternal + missingExternal; i--;)
-        {
-            if (i < missingInternal) {
-                internal = true;
+        for (bool internal : {false, true}) {
+            for (int64_t missing = internal ? missingInternal : missingExternal; missing > 0; missing -= KEYPOOL_WRITE_BATCH) {
+                // what the batch changes in memory is only kept once it's committed
+                const CHDChain chain = hdChain;
+                const int64_t max_keypool_index = m_max_keypool_index;
+                std::vector<CPubKey> pubkeys;
+                const bool txn = batch.TxnBegin();
+                try {
+                    GenerateNewKeys(batch, std::min(missing, KEYPOOL_WRITE_BATCH), internal, pubkeys);
+                    for (const CPubKey& pubkey : pubkeys) {
+                        AddKeypoolPubkeyWithDB(pubkey, internal, batch);
+                    }
+                    if (txn && !batch.TxnCommit()) {
+                        throw std::runtime_error(std::string(__func__) + ": writing new keys failed");
+                    }
+                } catch (...) {
+                    if (txn) batch.TxnAbort();
+                    ForgetUncommittedKeys(chain, max_keypool_index, pubkeys);
+                    throw;
+                }
             }
-
-            CPubKey pubkey(GenerateNewKey(batch, internal));
-            AddKeypoolPubkeyWithDB(pubkey, internal, batch);
         }
         if (missingInternal + missingExternal > 0) {
             WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
@@ -5035,7 +5367,10 @@ bool CWallet::AddKeyPubKeyInner(const CKey& key, const CPubKey &pubkey)
 {
     LOCK(cs_KeyStore);
     if (!IsCrypted()) {
-        return FillableSigningProvider::AddKeyPubKey(key, pubkey);
+        if (!FillableSigningProvider::AddKeyPubKey(key, pubkey))
+            return false;
+        MarkIsMineStale();
+        return true;
     }
 
     if (IsLocked()) {
@@ -5064,5 +5399,6 @@ bool CWallet::AddCryptedKeyInner(const CPubKey &vchPubKey, const std::vector<uns
 
     mapCryptedKeys[vchPubKey.GetID()] = make_pair(vchPubKey, vchCryptedSecret);
     ImplicitlyLearnRelatedKeyScripts(vchPubKey);
+    MarkIsMineStale();
     return true;
 }
@@ -574,14 +574,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        m_amounts[DEBIT].Reset();
-        m_amounts[CREDIT].Reset();
-        m_amounts[IMMATURE_CREDIT].Reset();
-        m_amounts[AVAILABLE_CREDIT].Reset();
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -791,6 +784,27 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void AddToSpends(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Our outputs that may still be unspent, by value, which AvailableCoins walks instead of every
+     * output of every wallet transaction. It errs on the side of holding too much: an output is
+     * dropped once a wallet transaction spends it and added back when that spend is abandoned,
+     * conflicted or zapped, and the whole set is worked out again after MarkDirty().
+     */
+    mutable std::set<std::pair<CAmount, COutPoint>> setSpendableCoins GUARDED_BY(cs_wallet);
+    mutable bool fSpendableCoinsStale GUARDED_BY(cs_wallet){true};
+    void AddSpendableCoin(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void EraseSpendableCoin(const COutPoint& outpoint) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /**
+     * IsMine results by the SHA256 of the script, and the generation they were worked out in, as the
+     * same scripts are looked at over and over. Adding keys or scripts starts a new generation,
+     * which only spendable results outlive, and removing a watch-only script empties the cache.
+     */
+    mutable Mutex cs_ismine_cache;
+    mutable robin_hood::unordered_map<uint256, std::pair<isminetype, uint64_t>> mapIsMineCache GUARDED_BY(cs_ismine_cache);
+    uint64_t nIsMineGeneration GUARDED_BY(cs_ismine_cache) = 0;
+    void MarkIsMineStale(bool removed = false);
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When
@@ -821,9 +835,15 @@ private:
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
 
+    /* HD derive the key new child keys are derived from (internal or external chain), and the id of the master key */
+    void DeriveChainKey(CExtKey& chainChildKey, CKeyID& master_id, bool internal) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(WalletBatch& batch, CKeyMetadata& metadata, CKey& secret, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /* Undo the in-memory side of keys generated into a keypool batch that didn't commit */
+    void ForgetUncommittedKeys(const CHDChain& chain, int64_t max_keypool_index, const std::vector<CPubKey>& pubkeys) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     std::set<int64_t> setInternalKeyPool GUARDED_BY(cs_wallet);
     std::set<int64_t> setExternalKeyPool GUARDED_BY(cs_wallet);
     std::set<int64_t> set_pre_split_keypool GUARDED_BY(cs_wallet);
@@ -1032,6 +1052,9 @@ public:
      * Generate a new key
      */
     CPubKey GenerateNewKey(WalletBatch& batch, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Generate count new keys, HD derived over several threads when possible, appending each to
+    //! pubkeys as it's added so that a failure partway leaves the ones to undo there
+    void GenerateNewKeys(WalletBatch& batch, int64_t count, bool internal, std::vector<CPubKey>& pubkeys) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey) override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
@@ -1131,10 +1154,37 @@ public:
         CAmount m_watchonly_trusted{0};
         CAmount m_watchonly_untrusted_pending{0};
         CAmount m_watchonly_immature{0};
+        CAmount m_mine_trusted_claims{0};    //!< The part of m_mine_trusted held in claims
+        CAmount m_mine_trusted_supports{0};  //!< The part of m_mine_trusted held in supports
+
+        Balance& operator+=(const Balance& other);
+        Balance& operator-=(const Balance& other);
+        bool IsZero() const;
     };
     Balance GetBalance(isminefilter filter = ISMINE_NO, int min_depth = 0, bool avoid_reuse = true, CAmount earlyExit = 0) const;
     CAmount GetAvailableBalance(const CCoinControl* coinControl = nullptr) const;
 
+    //! Have GetBalance count the transaction again, as its credit or status has changed
+    void MarkBalanceStale(const uint256& hash) const;
+
+private:
+    /**
+     * Running totals for GetBalance with its default arguments, the sum of what each transaction
+     * adds to it. Transactions marked stale are counted again on the next call, as are coinbases
+     * still maturing once the tip has moved; everything is, after MarkDirty() or a shorter chain.
+     */
+    mutable Balance m_balance GUARDED_BY(cs_wallet);
+    mutable std::map<uint256, Balance> m_tx_balances GUARDED_BY(cs_wallet); //!< non-zero contributions to m_balance
+    mutable std::set<uint256> m_balance_stale GUARDED_BY(cs_wallet);
+    mutable std::set<uint256> m_balance_maturing GUARDED_BY(cs_wallet);
+    mutable bool m_balance_all_stale GUARDED_BY(cs_wallet){true};
+    mutable int m_balance_height GUARDED_BY(cs_wallet){-1};
+
+    Balance GetTxBalance(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx, isminefilter filter, int min_depth) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateBalance(interfaces::Chain::Lock& locked_chain) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+public:
+
     OutputType TransactionChangeType(OutputType change_type, const std::vector<CRecipient>& vecSend);
 
     /**
@@ -1234,6 +1284,7 @@ public:
      */
     CAmount GetDebit(const CTxIn& txin, const isminefilter& filter) const;
     isminetype IsMine(const CTxOut& txout) const;
+    isminetype IsMine(const CScript& script) const;
     CAmount GetCredit(const CTxOut& txout, const isminefilter& filter) const;
     bool IsChange(const CTxOut& txout) const;
     bool IsChange(const CScript& script) const;